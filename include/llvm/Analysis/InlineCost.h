@@ -14,6 +14,8 @@
 #ifndef LLVM_ANALYSIS_INLINECOST_H
 #define LLVM_ANALYSIS_INLINECOST_H
 
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/CallGraphSCCPass.h"
 #include <cassert>
 #include <climits>
@@ -102,6 +104,13 @@ class InlineCostAnalysis : public CallGraphSCCPass {
   const DataLayout *TD;
   const TargetTransformInfo *TTI;
 
+  /// \brief Costs of call sites whose callee is no longer changing.
+  class CostCache;
+  OwningPtr<CostCache> Cache;
+
+  /// \brief The functions of the SCC currently being visited.
+  SmallPtrSet<const Function *, 8> CurrentSCC;
+
 public:
   static char ID;
 
@@ -111,6 +120,7 @@ public:
   // Pass interface implementation.
   void getAnalysisUsage(AnalysisUsage &AU) const;
   bool runOnSCC(CallGraphSCC &SCC);
+  bool doFinalization(CallGraph &CG);
 
   /// \brief Get an InlineCost object representing the cost of inlining this
   /// callsite.
@@ -121,7 +131,9 @@ public:
   /// sufficiently low to warrant inlining.
   ///
   /// Also note that calling this function *dynamically* computes the cost of
-  /// inlining the callsite. It is an expensive, heavyweight call.
+  /// inlining the callsite. It is an expensive, heavyweight call. The result
+  /// is cached for callees outside the SCC being visited, and reused for
+  /// later call sites that look the same to the analysis.
   InlineCost getInlineCost(CallSite CS, int Threshold);
 
   /// \brief Get an InlineCost with the callee explicitly specified.
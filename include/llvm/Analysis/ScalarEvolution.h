@@ -544,6 +544,19 @@ namespace llvm {
     /// pointer.
     bool checkValidity(const SCEV *S) const;
 
+    /// isArithBudgetExceeded - Return true if getAddExpr or getMulExpr should
+    /// stop simplifying the given operands.
+    bool
+    isArithBudgetExceeded(const SmallVectorImpl<const SCEV *> &Ops) const;
+
+    /// getOrCreateAddExpr - Unique an add of exactly the given operands.
+    const SCEV *getOrCreateAddExpr(const SmallVectorImpl<const SCEV *> &Ops,
+                                   SCEV::NoWrapFlags Flags);
+
+    /// getOrCreateMulExpr - Unique a mul of exactly the given operands.
+    const SCEV *getOrCreateMulExpr(const SmallVectorImpl<const SCEV *> &Ops,
+                                   SCEV::NoWrapFlags Flags);
+
   public:
     static char ID; // Pass identification, replacement for typeid
     ScalarEvolution();
@@ -900,6 +913,9 @@ namespace llvm {
     /// values that have been allocated. This is used by releaseMemory
     /// to locate them all and call their destructors.
     SCEVUnknown *FirstUnknown;
+
+    /// ArithDepth - The current nesting depth of getAddExpr and getMulExpr.
+    unsigned ArithDepth;
   };
 }
 
@@ -201,6 +201,11 @@ UseInitArray("use-init-array",
              cl::desc("Use .init_array instead of .ctors."),
              cl::init(false));
 
+cl::opt<bool>
+CompressDebugSections("compress-debug-sections",
+                      cl::desc("Compress DWARF debug sections in ELF objects."),
+                      cl::init(false));
+
 cl::opt<std::string> StopAfter("stop-after",
                             cl::desc("Stop compilation after a specific pass"),
                             cl::value_desc("pass-name"),
@@ -22,6 +22,7 @@
 
 namespace llvm {
   class FastISel;
+  class FastISelMissReport;
   class SelectionDAGBuilder;
   class SDValue;
   class MachineRegisterInfo;
@@ -66,6 +67,8 @@ public:
 
   virtual bool runOnMachineFunction(MachineFunction &MF);
 
+  virtual bool doFinalization(Module &M);
+
   virtual void EmitFunctionEntryCode() {}
 
   /// PreprocessISelDAG - This hook allows targets to hack on the graph before
@@ -172,6 +175,10 @@ public:
 
 
 protected:
+  /// MissReport - What FastISel failed to select, for -fast-isel-report.
+  ///
+  FastISelMissReport *MissReport;
+
   /// DAGSize - Size of DAG being instruction selected.
   ///
   unsigned DAGSize;
@@ -263,6 +270,11 @@ private:
                         bool &HadTailCall);
   void FinishBasicBlock();
 
+  /// \brief Select a block that only falls through to its layout successor
+  /// without building a DAG for it.  Returns false if the block at \p Begin
+  /// needs the full SelectionDAG path.
+  bool SelectTrivialBlock(BasicBlock::const_iterator Begin);
+
   void CodeGenAndEmitDAG();
 
   /// \brief Generate instructions for lowering the incoming arguments of the
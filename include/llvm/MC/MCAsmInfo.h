@@ -307,6 +307,10 @@ namespace llvm {
     /// instead of symbolic register names in .cfi_* directives.
     bool DwarfRegNumForCFI;  // Defaults to false;
 
+    /// CompressDebugSections - True if the object writer should emit
+    /// .debug_* sections zlib-compressed as .zdebug_* (the zlib-gnu format).
+    bool CompressDebugSections;  // Defaults to false.
+
     //===--- Prologue State ----------------------------------------------===//
 
     std::vector<MCCFIInstruction> InitialFrameState;
@@ -532,6 +536,11 @@ namespace llvm {
       return DwarfRegNumForCFI;
     }
 
+    bool compressDebugSections() const { return CompressDebugSections; }
+    void setCompressDebugSections(bool Value) {
+      CompressDebugSections = Value;
+    }
+
     void addInitialFrameState(const MCCFIInstruction &Inst) {
       InitialFrameState.push_back(Inst);
     }
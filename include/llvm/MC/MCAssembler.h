@@ -917,9 +917,8 @@ private:
   bool fragmentNeedsRelaxation(const MCRelaxableFragment *IF,
                                const MCAsmLayout &Layout) const;
 
-  /// \brief Perform one layout iteration and return true if any offsets
-  /// were adjusted.
-  bool layoutOnce(MCAsmLayout &Layout);
+  /// \brief Relax and lay out sections until no fragment changes size.
+  void layoutToFixedPoint(MCAsmLayout &Layout);
 
   /// \brief Perform one layout iteration of the given section and return true
   /// if any offsets were adjusted.
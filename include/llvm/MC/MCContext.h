@@ -254,6 +254,11 @@ namespace llvm {
                                       unsigned Flags, SectionKind Kind,
                                       unsigned EntrySize, StringRef Group);
 
+    /// renameELFSection - Give an existing ELF section a new name, keeping
+    /// the uniquing map in sync. Used when the object writer decides on the
+    /// final name of a section late, e.g. .debug_* becoming .zdebug_*.
+    void renameELFSection(const MCSectionELF *Section, StringRef Name);
+
     const MCSectionELF *CreateELFGroupSection();
 
     const MCSectionCOFF *getCOFFSection(StringRef Section,
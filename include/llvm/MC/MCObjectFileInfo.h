@@ -281,6 +281,11 @@ public:
     return DwarfAddrSection;
   }
 
+  /// getDwarfTypesSection - Return the COMDAT .debug_types section holding the
+  /// type unit with the given signature, or null if the object file format
+  /// has no support for type units.
+  const MCSection *getDwarfTypesSection(uint64_t Hash) const;
+
   const MCSection *getTLSExtraDataSection() const {
     return TLSExtraDataSection;
   }
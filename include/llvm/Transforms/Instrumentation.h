@@ -63,6 +63,12 @@ struct GCOVOptions {
 ModulePass *createGCOVProfilerPass(const GCOVOptions &Options =
                                    GCOVOptions::getDefault());
 
+// Insert edge counters for instrumentation based profile guided optimization.
+ModulePass *createEdgeProfilerPass();
+
+// Annotate branches and calls with the counts of an edge profile.
+ModulePass *createEdgeProfileLoaderPass(StringRef Filename = StringRef());
+
 // Insert AddressSanitizer (address sanity checking) instrumentation
 FunctionPass *createAddressSanitizerFunctionPass(
     bool CheckInitOrder = true, bool CheckUseAfterReturn = false,
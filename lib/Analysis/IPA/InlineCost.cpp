@@ -18,6 +18,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/ValueMap.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
@@ -35,9 +36,58 @@
 using namespace llvm;
 
 STATISTIC(NumCallsAnalyzed, "Number of call sites analyzed");
+STATISTIC(NumCachedCosts, "Number of call site costs found in the cache");
 
 namespace {
 
+/// \brief Everything about a call site, other than the callee, that the cost
+/// analysis depends on.
+///
+/// Two call sites of the same unchanged callee with equal keys get the same
+/// inline cost, so the result of analyzing one can be reused for the other.
+/// Arguments are described by the simplifications they enable rather than by
+/// identity, so call sites in different callers can share a key.
+struct CallSiteKey {
+  struct ArgInfo {
+    /// A constant argument, or null.
+    const Constant *C;
+    /// For arguments with a known constant offset from a base pointer, the
+    /// index of the first argument with the same base, which is the
+    /// argument's own index if no earlier one shares it; -1 otherwise.
+    int BaseIdx;
+    int64_t Offset;
+    bool IsAllocaBase;
+    bool IsByVal;
+
+    bool operator==(const ArgInfo &RHS) const {
+      return C == RHS.C && BaseIdx == RHS.BaseIdx && Offset == RHS.Offset &&
+             IsAllocaBase == RHS.IsAllocaBase && IsByVal == RHS.IsByVal;
+    }
+  };
+
+  int Threshold;
+  bool OnlyOneCallAndLocalLinkage;
+  bool FollowedByUnreachable;
+  bool IsCallerRecursive;
+  SmallVector<ArgInfo, 4> Args;
+
+  bool operator==(const CallSiteKey &RHS) const {
+    return Threshold == RHS.Threshold &&
+           OnlyOneCallAndLocalLinkage == RHS.OnlyOneCallAndLocalLinkage &&
+           FollowedByUnreachable == RHS.FollowedByUnreachable &&
+           IsCallerRecursive == RHS.IsCallerRecursive &&
+           Args.size() == RHS.Args.size() &&
+           std::equal(Args.begin(), Args.end(), RHS.Args.begin());
+  }
+};
+
+/// \brief The outcome of analyzing one call site.
+struct CallAnalysisResult {
+  bool ShouldInline;
+  int Cost;
+  int Threshold;
+};
+
 class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
   typedef InstVisitor<CallAnalyzer, bool> Base;
   friend class InstVisitor<CallAnalyzer, bool>;
@@ -156,6 +206,7 @@ public:
         SROACostSavingsLost(0) {}
 
   bool analyzeCall(CallSite CS);
+  bool computeCallSiteKey(CallSite CS, CallSiteKey &Key);
 
   int getThreshold() { return Threshold; }
   int getCost() { return Cost; }
@@ -176,6 +227,29 @@ public:
 
 } // namespace
 
+/// \brief Test whether any call site of Caller is within Caller itself.
+static bool isCallerRecursive(Function *Caller) {
+  for (Value::use_iterator U = Caller->use_begin(), E = Caller->use_end();
+       U != E; ++U) {
+    CallSite Site(cast<Value>(*U));
+    if (!Site)
+      continue;
+    Instruction *I = Site.getInstruction();
+    if (I->getParent()->getParent() == Caller)
+      return true;
+  }
+  return false;
+}
+
+/// \brief Test whether the call site is followed by an unreachable
+/// instruction, which means the callee does not return.
+static bool isFollowedByUnreachable(CallSite CS) {
+  Instruction *Instr = CS.getInstruction();
+  if (InvokeInst *II = dyn_cast<InvokeInst>(Instr))
+    return isa<UnreachableInst>(II->getNormalDest()->begin());
+  return isa<UnreachableInst>(++BasicBlock::iterator(Instr));
+}
+
 /// \brief Test whether the given value is an Alloca-derived function argument.
 bool CallAnalyzer::isAllocaDerivedArg(Value *V) {
   return SROAArgValues.count(V);
@@ -1019,11 +1093,7 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
   // invoke is an unreachable instruction, the function is noreturn. As such,
   // there is little point in inlining this unless there is literally zero
   // cost.
-  Instruction *Instr = CS.getInstruction();
-  if (InvokeInst *II = dyn_cast<InvokeInst>(Instr)) {
-    if (isa<UnreachableInst>(II->getNormalDest()->begin()))
-      Threshold = 1;
-  } else if (isa<UnreachableInst>(++BasicBlock::iterator(Instr)))
+  if (isFollowedByUnreachable(CS))
     Threshold = 1;
 
   // If this function uses the coldcc calling convention, prefer not to inline
@@ -1038,19 +1108,8 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
   if (F.empty())
     return true;
 
-  Function *Caller = CS.getInstruction()->getParent()->getParent();
   // Check if the caller function is recursive itself.
-  for (Value::use_iterator U = Caller->use_begin(), E = Caller->use_end();
-       U != E; ++U) {
-    CallSite Site(cast<Value>(*U));
-    if (!Site)
-      continue;
-    Instruction *I = Site.getInstruction();
-    if (I->getParent()->getParent() == Caller) {
-      IsCallerRecursive = true;
-      break;
-    }
-  }
+  IsCallerRecursive = isCallerRecursive(CS.getCaller());
 
   // Populate our simplified values by mapping from function arguments to call
   // arguments with known important simplifications.
@@ -1165,6 +1224,52 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
   return Cost < Threshold;
 }
 
+/// \brief Describe the call site in terms of what analyzeCall looks at.
+///
+/// Returns false if the call site has an argument that cannot be described
+/// safely, in which case its cost must not be cached.
+bool CallAnalyzer::computeCallSiteKey(CallSite CS, CallSiteKey &Key) {
+  Key.Threshold = Threshold;
+  Key.OnlyOneCallAndLocalLinkage = F.hasLocalLinkage() && F.hasOneUse() &&
+    &F == CS.getCalledFunction();
+  Key.FollowedByUnreachable = isFollowedByUnreachable(CS);
+  Key.IsCallerRecursive = isCallerRecursive(CS.getCaller());
+
+  SmallVector<Value *, 4> Bases;
+  Key.Args.clear();
+  for (unsigned I = 0, E = CS.arg_size(); I != E; ++I) {
+    Value *V = CS.getArgument(I);
+    CallSiteKey::ArgInfo Info;
+    Info.C = 0;
+    Info.BaseIdx = -1;
+    Info.Offset = 0;
+    Info.IsAllocaBase = false;
+    Info.IsByVal = TD && CS.isByValArgument(I);
+
+    // Only cache constants that live as long as the context. Anything that
+    // refers to a global may be destroyed and its address reused.
+    if (Constant *C = dyn_cast<Constant>(V)) {
+      if (!isa<ConstantInt>(C) && !isa<ConstantFP>(C) &&
+          !isa<ConstantPointerNull>(C) && !isa<UndefValue>(C))
+        return false;
+      Info.C = C;
+    }
+
+    Value *Base = V;
+    if (ConstantInt *Offset = stripAndComputeInBoundsConstantOffsets(Base)) {
+      if (Offset->getBitWidth() > 64)
+        return false;
+      Info.Offset = Offset->getSExtValue();
+      Info.IsAllocaBase = isa<AllocaInst>(Base);
+      Info.BaseIdx = std::find(Bases.begin(), Bases.end(), Base) -
+                     Bases.begin();
+    }
+    Bases.push_back(Base);
+    Key.Args.push_back(Info);
+  }
+  return true;
+}
+
 #if !defined(NDEBUG) || defined(LLVM_ENABLE_DUMP)
 /// \brief Dump stats about this call's analysis.
 void CallAnalyzer::dump() {
@@ -1190,7 +1295,49 @@ INITIALIZE_PASS_END(InlineCostAnalysis, "inline-cost", "Inline Cost Analysis",
 
 char InlineCostAnalysis::ID = 0;
 
-InlineCostAnalysis::InlineCostAnalysis() : CallGraphSCCPass(ID), TD(0) {}
+/// \brief The most call site keys remembered for a single callee.
+static const unsigned MaxCachedKeysPerCallee = 8;
+
+/// \brief Costs of recently analyzed call sites, grouped by callee.
+///
+/// Entries are dropped when their callee is deleted. The ValueMap must not
+/// follow RAUW, since a replacement function has a different body.
+class InlineCostAnalysis::CostCache {
+  struct NoFollowRAUWConfig : ValueMapConfig<const Function *> {
+    enum { FollowRAUW = false };
+  };
+  typedef SmallVector<std::pair<CallSiteKey, CallAnalysisResult>, 2>
+    EntryList;
+  typedef ValueMap<const Function *, EntryList, NoFollowRAUWConfig> MapTy;
+  MapTy Map;
+
+public:
+  const CallAnalysisResult *lookup(const Function *Callee,
+                                   const CallSiteKey &Key) {
+    MapTy::iterator I = Map.find(Callee);
+    if (I == Map.end())
+      return 0;
+    for (EntryList::iterator EI = I->second.begin(), EE = I->second.end();
+         EI != EE; ++EI)
+      if (EI->first == Key)
+        return &EI->second;
+    return 0;
+  }
+
+  void insert(const Function *Callee, const CallSiteKey &Key,
+              const CallAnalysisResult &Result) {
+    EntryList &Entries = Map[Callee];
+    if (Entries.size() >= MaxCachedKeysPerCallee)
+      Entries.erase(Entries.begin());
+    Entries.push_back(std::make_pair(Key, Result));
+  }
+
+  void erase(const Function *Callee) { Map.erase(Callee); }
+  void clear() { Map.clear(); }
+};
+
+InlineCostAnalysis::InlineCostAnalysis()
+    : CallGraphSCCPass(ID), TD(0), Cache(new CostCache()) {}
 
 InlineCostAnalysis::~InlineCostAnalysis() {}
 
@@ -1203,6 +1350,23 @@ void InlineCostAnalysis::getAnalysisUsage(AnalysisUsage &AU) const {
 bool InlineCostAnalysis::runOnSCC(CallGraphSCC &SCC) {
   TD = getAnalysisIfAvailable<DataLayout>();
   TTI = &getAnalysis<TargetTransformInfo>();
+
+  // The SCC is walked bottom-up, so only the functions of the current SCC can
+  // still be changed by the passes that run on it. Callees in SCCs that were
+  // already visited keep their cached costs.
+  CurrentSCC.clear();
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I)
+    if (Function *F = (*I)->getFunction()) {
+      CurrentSCC.insert(F);
+      Cache->erase(F);
+    }
+  return false;
+}
+
+bool InlineCostAnalysis::doFinalization(CallGraph &CG) {
+  // Anything may change before the next walk over the call graph.
+  Cache->clear();
+  CurrentSCC.clear();
   return false;
 }
 
@@ -1260,17 +1424,35 @@ InlineCost InlineCostAnalysis::getInlineCost(CallSite CS, Function *Callee,
         << "...\n");
 
   CallAnalyzer CA(TD, *TTI, *Callee, Threshold);
-  bool ShouldInline = CA.analyzeCall(CS);
 
-  DEBUG(CA.dump());
+  // Callees in the SCC being inlined into may change under us, so only the
+  // costs of calls to other functions are cached.
+  CallSiteKey Key;
+  bool Cacheable = !CurrentSCC.count(Callee) && CA.computeCallSiteKey(CS, Key);
+  CallAnalysisResult Result;
+  if (const CallAnalysisResult *Cached =
+        Cacheable ? Cache->lookup(Callee, Key) : 0) {
+    DEBUG(llvm::dbgs() << "      Using cached cost.\n");
+    ++NumCachedCosts;
+    Result = *Cached;
+  } else {
+    Result.ShouldInline = CA.analyzeCall(CS);
+    Result.Cost = CA.getCost();
+    Result.Threshold = CA.getThreshold();
+
+    DEBUG(CA.dump());
+
+    if (Cacheable)
+      Cache->insert(Callee, Key, Result);
+  }
 
   // Check if there was a reason to force inlining or no inlining.
-  if (!ShouldInline && CA.getCost() < CA.getThreshold())
+  if (!Result.ShouldInline && Result.Cost < Result.Threshold)
     return InlineCost::getNever();
-  if (ShouldInline && CA.getCost() >= CA.getThreshold())
+  if (Result.ShouldInline && Result.Cost >= Result.Threshold)
     return InlineCost::getAlways();
 
-  return llvm::InlineCost::get(CA.getCost(), CA.getThreshold());
+  return llvm::InlineCost::get(Result.Cost, Result.Threshold);
 }
 
 bool InlineCostAnalysis::isInlineViable(Function &F) {
@@ -29,6 +29,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/PredIteratorCache.h"
 using namespace llvm;
@@ -45,10 +46,20 @@ STATISTIC(NumUncacheNonLocalPtr,
           "Number of uncached non-local ptr responses");
 STATISTIC(NumCacheCompleteNonLocalPtr,
           "Number of block queries that were completely cached");
+STATISTIC(NumBlockLimitNonLocalPtr,
+          "Number of non-local ptr queries that hit the block limit");
 
 // Limit for the number of instructions to scan in a block.
 static const int BlockScanLimit = 100;
 
+// Limit on the number of blocks a single non-local pointer query may visit.
+// Without it, queries in large functions with many predecessors (e.g. big
+// switches) walk most of the CFG and fill the cache with per-block entries.
+static cl::opt<unsigned>
+BlockNumberLimit("memdep-block-number-limit", cl::Hidden, cl::init(1000),
+                 cl::desc("The number of blocks to scan during memory "
+                          "dependency analysis (default = 1000)"));
+
 char MemoryDependenceAnalysis::ID = 0;
 
 // Register this pass...
@@ -1041,6 +1052,19 @@ getNonLocalPointerDepFromBB(const PHITransAddr &Pointer,
   while (!Worklist.empty()) {
     BasicBlock *BB = Worklist.pop_back_val();
 
+    // If this query has already looked at too many blocks, give up.  The
+    // blocks still on the worklist get no results, so this has to be reported
+    // as a failure to the caller, which treats it as an unknown dependence.
+    // Entries already added to the cache are valid per-block results and are
+    // kept, but the cache no longer describes the whole query.
+    if (Visited.size() > BlockNumberLimit) {
+      ++NumBlockLimitNonLocalPtr;
+      CacheInfo->Pair = BBSkipFirstBlockPair();
+      SortNonLocalDepInfoCache(*Cache, NumSortedEntries);
+      DEBUG(AssertSorted(*Cache));
+      return true;
+    }
+
     // Skip the first block if we have it.
     if (!SkipFirstBlock) {
       // Analyze the dependency of *Pointer in FromBB.  See if we already have
@@ -98,6 +98,12 @@ STATISTIC(NumTripCountsNotComputed,
           "Number of loops without predictable loop counts");
 STATISTIC(NumBruteForceTripCountsComputed,
           "Number of loops with trip counts computed by force");
+STATISTIC(NumAddExprsNotSimplified,
+          "Number of add expressions not simplified due to size or depth");
+STATISTIC(NumMulExprsNotSimplified,
+          "Number of mul expressions not simplified due to size or depth");
+STATISTIC(NumAddMulExprsReused,
+          "Number of add and mul expressions found already uniqued");
 
 static cl::opt<unsigned>
 MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
@@ -106,6 +112,18 @@ MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
                                  "derived loop"),
                         cl::init(100));
 
+static cl::opt<unsigned>
+MaxArithDepth("scalar-evolution-max-arith-depth", cl::Hidden,
+              cl::desc("Maximum depth of nested add and mul simplification "
+                       "before SCEV gives up and builds the expression as is"),
+              cl::init(32));
+
+static cl::opt<unsigned>
+MaxArithOps("scalar-evolution-max-arith-operands", cl::Hidden,
+            cl::desc("Maximum number of operands of an add or mul expression "
+                     "that SCEV will try to simplify"),
+            cl::init(1024));
+
 // FIXME: Enable this with XDEBUG when the test suite is clean.
 static cl::opt<bool>
 VerifySCEV("verify-scev",
@@ -1456,6 +1474,27 @@ namespace {
   };
 }
 
+namespace {
+  /// ArithDepthTracker - Counts how deeply getAddExpr and getMulExpr are
+  /// currently nested within each other for the lifetime of the object.
+  class ArithDepthTracker {
+    unsigned &Depth;
+  public:
+    explicit ArithDepthTracker(unsigned &D) : Depth(D) { ++Depth; }
+    ~ArithDepthTracker() { --Depth; }
+  };
+}
+
+/// isArithBudgetExceeded - Return true if an add or mul of the given operands
+/// is too large or too deeply nested to be worth simplifying further.  The
+/// folds in getAddExpr and getMulExpr are quadratic in the number of operands
+/// and recurse freely, so huge or deeply nested expressions are uniqued as
+/// they are instead.
+bool ScalarEvolution::isArithBudgetExceeded(
+                              const SmallVectorImpl<const SCEV *> &Ops) const {
+  return ArithDepth > MaxArithDepth || Ops.size() > MaxArithOps;
+}
+
 /// getAddExpr - Get a canonical add expression, or something simpler if
 /// possible.
 const SCEV *ScalarEvolution::getAddExpr(SmallVectorImpl<const SCEV *> &Ops,
@@ -1464,6 +1503,7 @@ const SCEV *ScalarEvolution::getAddExpr(SmallVectorImpl<const SCEV *> &Ops,
          "only nuw or nsw allowed");
   assert(!Ops.empty() && "Cannot get empty add!");
   if (Ops.size() == 1) return Ops[0];
+  ArithDepthTracker DepthTracker(ArithDepth);
 #ifndef NDEBUG
   Type *ETy = getEffectiveSCEVType(Ops[0]->getType());
   for (unsigned i = 1, e = Ops.size(); i != e; ++i)
@@ -1512,6 +1552,11 @@ const SCEV *ScalarEvolution::getAddExpr(SmallVectorImpl<const SCEV *> &Ops,
     if (Ops.size() == 1) return Ops[0];
   }
 
+  if (isArithBudgetExceeded(Ops)) {
+    ++NumAddExprsNotSimplified;
+    return getOrCreateAddExpr(Ops, Flags);
+  }
+
   // Okay, check to see if the same value occurs in the operand list more than
   // once.  If so, merge them together into an multiply expression.  Since we
   // sorted the list, these values are required to be adjacent.
@@ -1807,8 +1852,15 @@ const SCEV *ScalarEvolution::getAddExpr(SmallVectorImpl<const SCEV *> &Ops,
     // next one.
   }
 
-  // Okay, it looks like we really DO need an add expr.  Check to see if we
-  // already have one, otherwise create a new one.
+  // Okay, it looks like we really DO need an add expr.
+  return getOrCreateAddExpr(Ops, Flags);
+}
+
+/// getOrCreateAddExpr - Return the uniqued add expression of exactly the
+/// given operands, creating it if needed.  No simplification is done.
+const SCEV *
+ScalarEvolution::getOrCreateAddExpr(const SmallVectorImpl<const SCEV *> &Ops,
+                                    SCEV::NoWrapFlags Flags) {
   FoldingSetNodeID ID;
   ID.AddInteger(scAddExpr);
   for (unsigned i = 0, e = Ops.size(); i != e; ++i)
@@ -1822,6 +1874,8 @@ const SCEV *ScalarEvolution::getAddExpr(SmallVectorImpl<const SCEV *> &Ops,
     S = new (SCEVAllocator) SCEVAddExpr(ID.Intern(SCEVAllocator),
                                         O, Ops.size());
     UniqueSCEVs.InsertNode(S, IP);
+  } else {
+    ++NumAddMulExprsReused;
   }
   S->setNoWrapFlags(Flags);
   return S;
@@ -1867,6 +1921,7 @@ const SCEV *ScalarEvolution::getMulExpr(SmallVectorImpl<const SCEV *> &Ops,
          "only nuw or nsw allowed");
   assert(!Ops.empty() && "Cannot get empty mul!");
   if (Ops.size() == 1) return Ops[0];
+  ArithDepthTracker DepthTracker(ArithDepth);
 #ifndef NDEBUG
   Type *ETy = getEffectiveSCEVType(Ops[0]->getType());
   for (unsigned i = 1, e = Ops.size(); i != e; ++i)
@@ -1957,6 +2012,11 @@ const SCEV *ScalarEvolution::getMulExpr(SmallVectorImpl<const SCEV *> &Ops,
       return Ops[0];
   }
 
+  if (isArithBudgetExceeded(Ops)) {
+    ++NumMulExprsNotSimplified;
+    return getOrCreateMulExpr(Ops, Flags);
+  }
+
   // Skip over the add expression until we get to a multiply.
   while (Idx < Ops.size() && Ops[Idx]->getSCEVType() < scMulExpr)
     ++Idx;
@@ -2101,8 +2161,15 @@ const SCEV *ScalarEvolution::getMulExpr(SmallVectorImpl<const SCEV *> &Ops,
     // next one.
   }
 
-  // Okay, it looks like we really DO need an mul expr.  Check to see if we
-  // already have one, otherwise create a new one.
+  // Okay, it looks like we really DO need an mul expr.
+  return getOrCreateMulExpr(Ops, Flags);
+}
+
+/// getOrCreateMulExpr - Return the uniqued mul expression of exactly the
+/// given operands, creating it if needed.  No simplification is done.
+const SCEV *
+ScalarEvolution::getOrCreateMulExpr(const SmallVectorImpl<const SCEV *> &Ops,
+                                    SCEV::NoWrapFlags Flags) {
   FoldingSetNodeID ID;
   ID.AddInteger(scMulExpr);
   for (unsigned i = 0, e = Ops.size(); i != e; ++i)
@@ -2116,6 +2183,8 @@ const SCEV *ScalarEvolution::getMulExpr(SmallVectorImpl<const SCEV *> &Ops,
     S = new (SCEVAllocator) SCEVMulExpr(ID.Intern(SCEVAllocator),
                                         O, Ops.size());
     UniqueSCEVs.InsertNode(S, IP);
+  } else {
+    ++NumAddMulExprsReused;
   }
   S->setNoWrapFlags(Flags);
   return S;
@@ -7260,7 +7329,7 @@ ScalarEvolution::SCEVCallbackVH::SCEVCallbackVH(Value *V, ScalarEvolution *se)
 //===----------------------------------------------------------------------===//
 
 ScalarEvolution::ScalarEvolution()
-  : FunctionPass(ID), ValuesAtScopes(64), LoopDispositions(64), BlockDispositions(64), FirstUnknown(0) {
+  : FunctionPass(ID), ValuesAtScopes(64), LoopDispositions(64), BlockDispositions(64), FirstUnknown(0), ArithDepth(0) {
   initializeScalarEvolutionPass(*PassRegistry::getPassRegistry());
 }
 
@@ -112,6 +112,15 @@ DIE::~DIE() {
     delete Children[i];
 }
 
+/// takeChildren - Detach all children from the DIE and hand their ownership
+/// over to the caller.
+void DIE::takeChildren(std::vector<DIE *> &Result) {
+  for (unsigned i = 0, N = Children.size(); i < N; ++i)
+    Children[i]->Parent = 0;
+  Result.swap(Children);
+  Children.clear();
+}
+
 /// Climb up the parent chain to get the compile unit DIE to which this DIE
 /// belongs.
 const DIE *DIE::getCompileUnit() const {
@@ -121,11 +130,13 @@ const DIE *DIE::getCompileUnit() const {
 }
 
 /// Climb up the parent chain to get the compile unit DIE this DIE belongs
-/// to. Return NULL if DIE is not added to an owner yet.
+/// to. Return NULL if DIE is not added to an owner yet. DIEs of a type unit
+/// belong to its DW_TAG_type_unit DIE.
 const DIE *DIE::getCompileUnitOrNull() const {
   const DIE *p = this;
   while (p) {
-    if (p->getTag() == dwarf::DW_TAG_compile_unit)
+    if (p->getTag() == dwarf::DW_TAG_compile_unit ||
+        p->getTag() == dwarf::DW_TAG_type_unit)
       return p;
     p = p->getParent();
   }
@@ -133,21 +144,30 @@ const DIE *DIE::getCompileUnitOrNull() const {
 }
 
 DIEValue *DIE::findAttribute(uint16_t Attribute) {
-  const SmallVectorImpl<DIEValue *> &Values = getValues();
-  const DIEAbbrev &Abbrevs = getAbbrev();
-
   // Iterate through all the attributes until we find the one we're
   // looking for, if we can't find it return NULL.
   for (size_t i = 0; i < Values.size(); ++i)
-    if (Abbrevs.getData()[i].getAttribute() == Attribute)
-      return Values[i];
+    if (Values[i].getAttribute() == Attribute)
+      return Values[i].getValue();
   return NULL;
 }
 
+/// profileAbbrev - Gather the data that uniquely identifies the abbreviation
+/// of this DIE. This has to agree with DIEAbbrev::Profile so that a DIE can be
+/// looked up in the set of interned abbreviations without building one.
+void DIE::profileAbbrev(FoldingSetNodeID &ID) const {
+  ID.AddInteger(unsigned(Tag));
+  ID.AddInteger(getChildrenFlag());
+
+  // For each attribute description.
+  for (unsigned i = 0, N = Values.size(); i < N; ++i)
+    Values[i].Profile(ID);
+}
+
 #ifndef NDEBUG
 void DIE::print(raw_ostream &O, unsigned IndentCount) const {
   const std::string Indent(IndentCount, ' ');
-  bool isBlock = Abbrev.getTag() == 0;
+  bool isBlock = Tag == 0;
 
   if (!isBlock) {
     O << Indent
@@ -157,28 +177,26 @@ void DIE::print(raw_ostream &O, unsigned IndentCount) const {
       << ", Size: " << Size << "\n";
 
     O << Indent
-      << dwarf::TagString(Abbrev.getTag())
+      << dwarf::TagString(Tag)
       << " "
-      << dwarf::ChildrenString(Abbrev.getChildrenFlag()) << "\n";
+      << dwarf::ChildrenString(getChildrenFlag()) << "\n";
   } else {
     O << "Size: " << Size << "\n";
   }
 
-  const SmallVectorImpl<DIEAbbrevData> &Data = Abbrev.getData();
-
   IndentCount += 2;
-  for (unsigned i = 0, N = Data.size(); i < N; ++i) {
+  for (unsigned i = 0, N = Values.size(); i < N; ++i) {
     O << Indent;
 
     if (!isBlock)
-      O << dwarf::AttributeString(Data[i].getAttribute());
+      O << dwarf::AttributeString(Values[i].getAttribute());
     else
       O << "Blk[" << i << "]";
 
     O <<  "  "
-      << dwarf::FormEncodingString(Data[i].getForm())
+      << dwarf::FormEncodingString(Values[i].getForm())
       << " ";
-    Values[i]->print(O);
+    Values[i].getValue()->print(O);
     O << "\n";
   }
   IndentCount -= 2;
@@ -397,6 +415,23 @@ void DIEEntry::print(raw_ostream &O) const {
 }
 #endif
 
+//===----------------------------------------------------------------------===//
+// DIETypeSignature Implementation
+//===----------------------------------------------------------------------===//
+
+/// EmitValue - Emit the type signature.
+///
+void DIETypeSignature::EmitValue(AsmPrinter *AP, dwarf::Form Form) const {
+  assert(Form == dwarf::DW_FORM_ref_sig8);
+  AP->OutStreamer.EmitIntValue(Signature, sizeof(uint64_t));
+}
+
+#ifndef NDEBUG
+void DIETypeSignature::print(raw_ostream &O) const {
+  O << format("Type Unit: 0x%llx", (unsigned long long)Signature);
+}
+#endif
+
 //===----------------------------------------------------------------------===//
 // DIEBlock Implementation
 //===----------------------------------------------------------------------===//
@@ -404,11 +439,9 @@ void DIEEntry::print(raw_ostream &O) const {
 /// ComputeSize - calculate the size of the block.
 ///
 unsigned DIEBlock::ComputeSize(AsmPrinter *AP) {
-  if (!Size) {
-    const SmallVectorImpl<DIEAbbrevData> &AbbrevData = Abbrev.getData();
+  if (!Size)
     for (unsigned i = 0, N = Values.size(); i < N; ++i)
-      Size += Values[i]->SizeOf(AP, AbbrevData[i].getForm());
-  }
+      Size += Values[i].getValue()->SizeOf(AP, Values[i].getForm());
 
   return Size;
 }
@@ -424,9 +457,8 @@ void DIEBlock::EmitValue(AsmPrinter *Asm, dwarf::Form Form) const {
   case dwarf::DW_FORM_block:  Asm->EmitULEB128(Size); break;
   }
 
-  const SmallVectorImpl<DIEAbbrevData> &AbbrevData = Abbrev.getData();
   for (unsigned i = 0, N = Values.size(); i < N; ++i)
-    Values[i]->EmitValue(Asm, AbbrevData[i].getForm());
+    Values[i].getValue()->EmitValue(Asm, Values[i].getForm());
 }
 
 /// SizeOf - Determine size of block data in bytes.
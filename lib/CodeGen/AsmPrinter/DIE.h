@@ -33,17 +33,19 @@ namespace llvm {
   class DIEAbbrevData {
     /// Attribute - Dwarf attribute code.
     ///
-    dwarf::Attribute Attribute;
+    uint16_t Attribute;
 
     /// Form - Dwarf form code.
     ///
-    dwarf::Form Form;
+    uint16_t Form;
   public:
     DIEAbbrevData(dwarf::Attribute A, dwarf::Form F) : Attribute(A), Form(F) {}
 
     // Accessors.
-    dwarf::Attribute getAttribute() const { return Attribute; }
-    dwarf::Form getForm() const { return Form; }
+    dwarf::Attribute getAttribute() const {
+      return static_cast<dwarf::Attribute>(Attribute);
+    }
+    dwarf::Form getForm() const { return static_cast<dwarf::Form>(Form); }
 
     /// Profile - Used to gather unique data for the abbreviation folding set.
     ///
@@ -101,11 +103,25 @@ namespace llvm {
 #endif
   };
 
-  //===--------------------------------------------------------------------===//
-  /// DIE - A structured debug information entry.  Has an abbreviation which
-  /// describes its organization.
   class DIEValue;
 
+  //===--------------------------------------------------------------------===//
+  /// DIEAttrValue - One attribute of a DIE: the attribute and form that go
+  /// into its abbreviation, together with the value itself.
+  class DIEAttrValue : public DIEAbbrevData {
+    DIEValue *Value;
+  public:
+    DIEAttrValue(dwarf::Attribute A, dwarf::Form F, DIEValue *V)
+      : DIEAbbrevData(A, F), Value(V) {}
+
+    // Accessors.
+    DIEValue *getValue() const { return Value; }
+  };
+
+  //===--------------------------------------------------------------------===//
+  /// DIE - A structured debug information entry.  Its organization is
+  /// described by an abbreviation, which is interned by the unit the DIE is
+  /// laid out in; the DIE itself only records the abbreviation number.
   class DIE {
   protected:
     /// Offset - Offset in debug info section.
@@ -116,9 +132,13 @@ namespace llvm {
     ///
     unsigned Size;
 
-    /// Abbrev - Buffer for constructing abbreviation.
+    /// AbbrevNumber - Number of the abbreviation describing this DIE.
     ///
-    DIEAbbrev Abbrev;
+    unsigned AbbrevNumber;
+
+    /// Tag - Dwarf tag code.
+    ///
+    uint16_t Tag;
 
     /// Children DIEs.
     ///
@@ -126,25 +146,25 @@ namespace llvm {
 
     DIE *Parent;
 
-    /// Attribute values.
+    /// Attribute values, with the attribute and form of each.
     ///
-    SmallVector<DIEValue*, 12> Values;
+    SmallVector<DIEAttrValue, 6> Values;
 
   public:
     explicit DIE(unsigned Tag)
-        : Offset(0), Size(0), Abbrev((dwarf::Tag)Tag, dwarf::DW_CHILDREN_no),
-          Parent(0) {}
+        : Offset(0), Size(0), AbbrevNumber(0), Tag(Tag), Parent(0) {}
     virtual ~DIE();
 
     // Accessors.
-    DIEAbbrev &getAbbrev() { return Abbrev; }
-    const DIEAbbrev &getAbbrev() const { return Abbrev; }
-    unsigned getAbbrevNumber() const { return Abbrev.getNumber(); }
-    dwarf::Tag getTag() const { return Abbrev.getTag(); }
+    unsigned getAbbrevNumber() const { return AbbrevNumber; }
+    dwarf::Tag getTag() const { return static_cast<dwarf::Tag>(Tag); }
+    uint16_t getChildrenFlag() const {
+      return Children.empty() ? dwarf::DW_CHILDREN_no : dwarf::DW_CHILDREN_yes;
+    }
     unsigned getOffset() const { return Offset; }
     unsigned getSize() const { return Size; }
     const std::vector<DIE *> &getChildren() const { return Children; }
-    const SmallVectorImpl<DIEValue*> &getValues() const { return Values; }
+    const SmallVectorImpl<DIEAttrValue> &getValues() const { return Values; }
     DIE *getParent() const { return Parent; }
     /// Climb up the parent chain to get the compile unit DIE this DIE belongs
     /// to.
@@ -152,6 +172,7 @@ namespace llvm {
     /// Similar to getCompileUnit, returns null when DIE is not added to an
     /// owner yet.
     const DIE *getCompileUnitOrNull() const;
+    void setAbbrevNumber(unsigned N) { AbbrevNumber = N; }
     void setOffset(unsigned O) { Offset = O; }
     void setSize(unsigned S) { Size = S; }
 
@@ -159,23 +180,33 @@ namespace llvm {
     ///
     void addValue(dwarf::Attribute Attribute, dwarf::Form Form,
                   DIEValue *Value) {
-      Abbrev.AddAttribute(Attribute, Form);
-      Values.push_back(Value);
+      Values.push_back(DIEAttrValue(Attribute, Form, Value));
     }
 
+    /// clearValues - Drop all of the attribute values of the DIE.  The values
+    /// themselves are owned by their allocator.
+    void clearValues() { Values.clear(); }
+
     /// addChild - Add a child to the DIE.
     ///
     void addChild(DIE *Child) {
       assert(!Child->getParent());
-      Abbrev.setChildrenFlag(dwarf::DW_CHILDREN_yes);
       Children.push_back(Child);
       Child->Parent = this;
     }
 
+    /// takeChildren - Detach all children from the DIE and hand their
+    /// ownership over to the caller.
+    void takeChildren(std::vector<DIE *> &Result);
+
     /// findAttribute - Find a value in the DIE with the attribute given, returns NULL
     /// if no such attribute exists.
     DIEValue *findAttribute(uint16_t Attribute);
 
+    /// profileAbbrev - Gather the data that uniquely identifies the
+    /// abbreviation of this DIE, matching DIEAbbrev::Profile.
+    void profileAbbrev(FoldingSetNodeID &ID) const;
+
 #ifndef NDEBUG
     void print(raw_ostream &O, unsigned IndentCount = 0) const;
     void dump();
@@ -195,6 +226,7 @@ namespace llvm {
       isLabel,
       isDelta,
       isEntry,
+      isTypeSignature,
       isBlock
     };
   protected:
@@ -406,6 +438,38 @@ namespace llvm {
     // Implement isa/cast/dyncast.
     static bool classof(const DIEValue *E) { return E->getType() == isEntry; }
 
+#ifndef NDEBUG
+    virtual void print(raw_ostream &O) const;
+#endif
+  };
+
+  //===--------------------------------------------------------------------===//
+  /// DIETypeSignature - A reference to a type unit, by the signature of the
+  /// type it describes.
+  class DIETypeSignature : public DIEValue {
+    uint64_t Signature;
+  public:
+    explicit DIETypeSignature(uint64_t S)
+      : DIEValue(isTypeSignature), Signature(S) {}
+
+    uint64_t getSignature() const { return Signature; }
+
+    /// EmitValue - Emit the type signature.
+    ///
+    virtual void EmitValue(AsmPrinter *AP, dwarf::Form Form) const;
+
+    /// SizeOf - Determine size of the type signature in bytes.
+    ///
+    virtual unsigned SizeOf(AsmPrinter *AP, dwarf::Form Form) const {
+      assert(Form == dwarf::DW_FORM_ref_sig8);
+      return sizeof(uint64_t);
+    }
+
+    // Implement isa/cast/dyncast.
+    static bool classof(const DIEValue *E) {
+      return E->getType() == isTypeSignature;
+    }
+
 #ifndef NDEBUG
     virtual void print(raw_ostream &O) const;
 #endif
@@ -30,14 +30,13 @@ using namespace llvm;
 /// \brief Grabs the string in whichever attribute is passed in and returns
 /// a reference to it.
 static StringRef getDIEStringAttr(const DIE &Die, uint16_t Attr) {
-  const SmallVectorImpl<DIEValue *> &Values = Die.getValues();
-  const DIEAbbrev &Abbrevs = Die.getAbbrev();
+  const SmallVectorImpl<DIEAttrValue> &Values = Die.getValues();
 
   // Iterate through all the attributes until we find the one we're
   // looking for, if we can't find it return an empty string.
   for (size_t i = 0; i < Values.size(); ++i) {
-    if (Abbrevs.getData()[i].getAttribute() == Attr) {
-      DIEValue *V = Values[i];
+    if (Values[i].getAttribute() == Attr) {
+      DIEValue *V = Values[i].getValue();
       assert(isa<DIEString>(V) && "String requested. Not a string.");
       DIEString *S = cast<DIEString>(V);
       return S->getString();
@@ -120,20 +119,19 @@ void DIEHash::addParentContext(const DIE &Parent) {
 
 // Collect all of the attributes for a particular DIE in single structure.
 void DIEHash::collectAttributes(const DIE &Die, DIEAttrs &Attrs) {
-  const SmallVectorImpl<DIEValue *> &Values = Die.getValues();
-  const DIEAbbrev &Abbrevs = Die.getAbbrev();
+  const SmallVectorImpl<DIEAttrValue> &Values = Die.getValues();
 
 #define COLLECT_ATTR(NAME)                                                     \
   case dwarf::NAME:                                                            \
-    Attrs.NAME.Val = Values[i];                                                \
-    Attrs.NAME.Desc = &Abbrevs.getData()[i];                                   \
+    Attrs.NAME.Val = Values[i].getValue();                                     \
+    Attrs.NAME.Desc = &Values[i];                                              \
     break
 
   for (size_t i = 0, e = Values.size(); i != e; ++i) {
     DEBUG(dbgs() << "Attribute: "
-                 << dwarf::AttributeString(Abbrevs.getData()[i].getAttribute())
+                 << dwarf::AttributeString(Values[i].getAttribute())
                  << " added.\n");
-    switch (Abbrevs.getData()[i].getAttribute()) {
+    switch (Values[i].getAttribute()) {
     COLLECT_ATTR(DW_AT_name);
     COLLECT_ATTR(DW_AT_accessibility);
     COLLECT_ATTR(DW_AT_address_class);
@@ -308,14 +306,37 @@ void DIEHash::hashAttribute(AttrEntry Attr, dwarf::Tag Tag) {
   case dwarf::DW_FORM_data4:
   case dwarf::DW_FORM_data8:
   case dwarf::DW_FORM_udata:
+  case dwarf::DW_FORM_sdata:
     addULEB128(dwarf::DW_FORM_sdata);
     addSLEB128((int64_t)cast<DIEInteger>(Value)->getValue());
     break;
+  // A present flag is hashed as the flag value it stands for.
+  case dwarf::DW_FORM_flag_present:
+  case dwarf::DW_FORM_flag:
+    addULEB128(dwarf::DW_FORM_flag);
+    addULEB128((uint8_t)cast<DIEInteger>(Value)->getValue());
+    break;
+  case dwarf::DW_FORM_block1:
+  case dwarf::DW_FORM_block2:
+  case dwarf::DW_FORM_block4:
+  case dwarf::DW_FORM_block:
+    addULEB128(dwarf::DW_FORM_block);
+    hashBlockData(cast<DIEBlock>(Value)->getValues());
+    break;
   default:
     llvm_unreachable("Add support for additional forms");
   }
 }
 
+// Hash the contents of a block attribute. Type entries only carry constant
+// location expressions (data member and vtable element locations), so the
+// operations are hashed by value, preceded by their count.
+void DIEHash::hashBlockData(const SmallVectorImpl<DIEAttrValue> &Values) {
+  addULEB128(Values.size());
+  for (size_t i = 0, e = Values.size(); i != e; ++i)
+    addULEB128(cast<DIEInteger>(Values[i].getValue())->getValue());
+}
+
 // Go through the attributes from \param Attrs in the order specified in 7.27.4
 // and hash them.
 void DIEHash::hashAttributes(const DIEAttrs &Attrs, dwarf::Tag Tag) {
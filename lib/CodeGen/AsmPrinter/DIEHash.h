@@ -125,6 +125,9 @@ private:
   /// \brief Hashes an individual attribute.
   void hashAttribute(AttrEntry Attr, dwarf::Tag Tag);
 
+  /// \brief Hashes the constant operations of a block attribute.
+  void hashBlockData(const SmallVectorImpl<DIEAttrValue> &Values);
+
   /// \brief Hashes an attribute that refers to another DIE.
   void hashDIEEntry(dwarf::Attribute Attribute, dwarf::Tag Tag,
                     const DIE &Entry);
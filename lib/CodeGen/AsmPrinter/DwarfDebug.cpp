@@ -47,6 +47,7 @@
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
 #include "llvm/Target/TargetRegisterInfo.h"
+#include <set>
 using namespace llvm;
 
 static cl::opt<bool>
@@ -68,6 +69,11 @@ GenerateCUHash("generate-cu-hash", cl::Hidden,
                cl::desc("Add the CU hash as the dwo_id."),
                cl::init(false));
 
+static cl::opt<bool>
+GenerateTypeUnits("generate-type-units", cl::Hidden,
+                  cl::desc("Move complete C++ types into DWARF4 type units."),
+                  cl::init(false));
+
 static cl::opt<bool>
 GenerateGnuPubSections("generate-gnu-dwarf-pub-sections", cl::Hidden,
                        cl::desc("Generate GNU-style pubnames and pubtypes"),
@@ -105,6 +111,8 @@ DwarfPubSections("generate-dwarf-pub-sections", cl::Hidden,
                             clEnumVal(Disable, "Disabled"), clEnumValEnd),
                  cl::init(Default));
 
+STATISTIC(NumTypeUnits, "Number of type units emitted");
+
 static const char *const DWARFGroupName = "DWARF Emission";
 static const char *const DbgTimerName = "DWARF Debug Writer";
 
@@ -114,6 +122,10 @@ static const char *const DbgTimerName = "DWARF Debug Writer";
 //
 static const unsigned InitAbbreviationsSetSize = 9; // log2(512)
 
+// Size of a type unit header following the unit length: version, offset into
+// the abbreviation section, address size, type signature and type offset.
+static const unsigned TypeUnitHeaderSize = 2 + 4 + 1 + 8 + 4;
+
 namespace llvm {
 
 /// resolve - Look in the DwarfDebug map for the MDNode that
@@ -270,23 +282,40 @@ unsigned DwarfUnits::getAddrPoolIndex(const MCExpr *Sym) {
   return P.first->second;
 }
 
+DwarfUnits::~DwarfUnits() {
+  // The abbreviations live in the allocator, but may have spilled their
+  // attribute data to the heap.
+  for (unsigned i = 0, e = Abbreviations.size(); i != e; ++i)
+    Abbreviations[i]->~DIEAbbrev();
+}
+
 // Define a unique number for the abbreviation.
 //
-void DwarfUnits::assignAbbrevNumber(DIEAbbrev &Abbrev) {
+void DwarfUnits::assignAbbrevNumber(DIE &Die) {
   // Check the set for priors.
-  DIEAbbrev *InSet = AbbreviationsSet->GetOrInsertNode(&Abbrev);
-
-  // If it's newly added.
-  if (InSet == &Abbrev) {
-    // Add to abbreviation list.
-    Abbreviations.push_back(&Abbrev);
-
-    // Assign the vector position + 1 as its number.
-    Abbrev.setNumber(Abbreviations.size());
-  } else {
+  FoldingSetNodeID ID;
+  Die.profileAbbrev(ID);
+  void *InsertPos;
+  if (DIEAbbrev *InSet = AbbreviationsSet->FindNodeOrInsertPos(ID, InsertPos)) {
     // Assign existing abbreviation number.
-    Abbrev.setNumber(InSet->getNumber());
+    Die.setAbbrevNumber(InSet->getNumber());
+    return;
   }
+
+  // Intern a new abbreviation, built from the attributes of the DIE.
+  DIEAbbrev *Abbrev =
+      new (AbbrevAllocator) DIEAbbrev(Die.getTag(), Die.getChildrenFlag());
+  const SmallVectorImpl<DIEAttrValue> &Values = Die.getValues();
+  for (unsigned i = 0, e = Values.size(); i != e; ++i)
+    Abbrev->AddAttribute(Values[i].getAttribute(), Values[i].getForm());
+  AbbreviationsSet->InsertNode(Abbrev, InsertPos);
+
+  // Add to abbreviation list.
+  Abbreviations.push_back(Abbrev);
+
+  // Assign the vector position + 1 as its number.
+  Abbrev->setNumber(Abbreviations.size());
+  Die.setAbbrevNumber(Abbrev->getNumber());
 }
 
 static bool isObjCClass(StringRef Name) {
@@ -1037,6 +1066,369 @@ static bool shouldAddODRHash(CompileUnit *CU, DIE *Die) {
          !isContainedInAnonNamespace(Die);
 }
 
+/// Return true if the DIE is nested in nothing but namespaces.
+static bool isNamespaceScoped(const DIE *Die) {
+  for (const DIE *P = Die->getParent();
+       P->getTag() != dwarf::DW_TAG_compile_unit; P = P->getParent())
+    if (P->getTag() != dwarf::DW_TAG_namespace)
+      return false;
+  return true;
+}
+
+/// Return true if the value can be copied into a type unit. A type unit lives
+/// in a COMDAT group that may stand in for the ones of other object files, so
+/// it can only hold constants, strings and references to other DIEs.
+static bool isTypeUnitValue(const DIEValue *V) {
+  if (isa<DIEInteger>(V) || isa<DIEString>(V) || isa<DIEEntry>(V))
+    return true;
+  const DIEBlock *Block = dyn_cast<DIEBlock>(V);
+  if (!Block)
+    return false;
+  const SmallVectorImpl<DIEAttrValue> &Values = Block->getValues();
+  for (unsigned i = 0, e = Values.size(); i != e; ++i)
+    if (!isa<DIEInteger>(Values[i].getValue()))
+      return false;
+  return true;
+}
+
+/// Return true if the type, along with everything it refers to other than the
+/// types in \p Split, can be copied into a type unit.
+static bool isSelfContainedType(const DIE *Ty,
+                                const SmallPtrSet<const DIE *, 16> &Split) {
+  SmallPtrSet<const DIE *, 32> Visited;
+  SmallVector<const DIE *, 32> Worklist;
+  Visited.insert(Ty);
+  Worklist.push_back(Ty);
+  while (!Worklist.empty()) {
+    const DIE *Die = Worklist.pop_back_val();
+    const SmallVectorImpl<DIEAttrValue> &Values = Die->getValues();
+    for (unsigned i = 0, e = Values.size(); i != e; ++i) {
+      const DIEValue *V = Values[i].getValue();
+      if (!isTypeUnitValue(V))
+        return false;
+      // Other split out types are referred to by signature.
+      if (const DIEEntry *E = dyn_cast<DIEEntry>(V))
+        if (!Split.count(E->getEntry()) && Visited.insert(E->getEntry()))
+          Worklist.push_back(E->getEntry());
+    }
+    const std::vector<DIE *> &Children = Die->getChildren();
+    for (unsigned i = 0, e = Children.size(); i != e; ++i)
+      if (Visited.insert(Children[i]))
+        Worklist.push_back(Children[i]);
+  }
+  return true;
+}
+
+/// Copy the attribute \p Attr of \p From, if it has one, onto \p To.
+static void copyAttribute(const DIE &From, DIE &To, dwarf::Attribute Attr) {
+  const SmallVectorImpl<DIEAttrValue> &Values = From.getValues();
+  for (unsigned i = 0, e = Values.size(); i != e; ++i)
+    if (Values[i].getAttribute() == Attr) {
+      To.addValue(Attr, Values[i].getForm(), Values[i].getValue());
+      return;
+    }
+}
+
+namespace {
+/// \brief Copies a type, and everything it refers to, into a type unit.
+class TypeUnitCloner {
+  BumpPtrAllocator &DIEValueAllocator;
+
+  // Signatures of the types that are split out into type units.
+  const DenseMap<const DIE *, uint64_t> &Signatures;
+
+  // The DW_TAG_type_unit DIE being filled in.
+  DIE *UnitDie;
+
+  // The value of flags that are present.
+  DIEInteger *FlagPresent;
+
+  // Complete copies in the unit, by original DIE.
+  DenseMap<const DIE *, DIE *> Clones;
+
+  // Namespaces and declarations standing in for the scopes of the copies,
+  // by original DIE.
+  DenseMap<const DIE *, DIE *> Scopes;
+
+  // Copies that still have to get the attributes of their original.
+  SmallVector<std::pair<const DIE *, DIE *>, 32> Worklist;
+
+  DIE *cloneTree(const DIE &Orig);
+  DIE *getScope(const DIE &Orig);
+  DIE *getClone(const DIE &Orig);
+  void cloneValues(const DIE &Orig, DIE &Clone);
+
+public:
+  TypeUnitCloner(BumpPtrAllocator &A,
+                 const DenseMap<const DIE *, uint64_t> &Signatures,
+                 DIE *UnitDie, DIEInteger *FlagPresent)
+      : DIEValueAllocator(A), Signatures(Signatures), UnitDie(UnitDie),
+        FlagPresent(FlagPresent) {}
+
+  /// \brief Copy the type \p Ty into the unit and return the copy.
+  DIE *cloneType(const DIE &Ty);
+};
+} // end anonymous namespace
+
+// Copy the DIE and its children, deferring their attributes until everything
+// they may refer to in the subtree has been copied.
+DIE *TypeUnitCloner::cloneTree(const DIE &Orig) {
+  DIE *Clone = new DIE(Orig.getTag());
+  Clones[&Orig] = Clone;
+  Worklist.push_back(std::make_pair(&Orig, Clone));
+  const std::vector<DIE *> &Children = Orig.getChildren();
+  for (unsigned i = 0, e = Children.size(); i != e; ++i)
+    Clone->addChild(cloneTree(*Children[i]));
+  return Clone;
+}
+
+// Return the DIE in the unit that stands for the scope \p Orig.
+DIE *TypeUnitCloner::getScope(const DIE &Orig) {
+  if (DIE *Clone = Clones.lookup(&Orig))
+    return Clone;
+  if (DIE *Scope = Scopes.lookup(&Orig))
+    return Scope;
+
+  // Namespaces are reproduced and types declared. Anything else, such as the
+  // compile unit or a function, cannot be described in a type unit, so the
+  // DIEs it holds go at the top level of the unit.
+  dwarf::Tag Tag = Orig.getTag();
+  bool IsNamespace = Tag == dwarf::DW_TAG_namespace;
+  if (!IsNamespace && !dwarf::isType(Tag))
+    return UnitDie;
+
+  DIE *Scope = new DIE(Tag);
+  copyAttribute(Orig, *Scope, dwarf::DW_AT_name);
+  if (!IsNamespace)
+    Scope->addValue(dwarf::DW_AT_declaration, dwarf::DW_FORM_flag_present,
+                    FlagPresent);
+  getScope(*Orig.getParent())->addChild(Scope);
+  Scopes[&Orig] = Scope;
+  return Scope;
+}
+
+// Return the copy of a DIE referred to from the unit, copying it in on first
+// use.
+DIE *TypeUnitCloner::getClone(const DIE &Orig) {
+  if (DIE *Clone = Clones.lookup(&Orig))
+    return Clone;
+  DIE *Clone = cloneTree(Orig);
+  getScope(*Orig.getParent())->addChild(Clone);
+  return Clone;
+}
+
+// Give the copy the attributes of its original. Values are shared, except for
+// references, which go to the copies in the unit or, for other split out
+// types, by signature.
+void TypeUnitCloner::cloneValues(const DIE &Orig, DIE &Clone) {
+  const SmallVectorImpl<DIEAttrValue> &Values = Orig.getValues();
+  for (unsigned i = 0, e = Values.size(); i != e; ++i) {
+    dwarf::Attribute Attr = Values[i].getAttribute();
+    const DIEEntry *E = dyn_cast<DIEEntry>(Values[i].getValue());
+    if (!E) {
+      Clone.addValue(Attr, Values[i].getForm(), Values[i].getValue());
+      continue;
+    }
+    const DIE *Target = E->getEntry();
+    DenseMap<const DIE *, uint64_t>::const_iterator Sig =
+        Signatures.find(Target);
+    if (Sig != Signatures.end() && !Clones.count(Target)) {
+      Clone.addValue(Attr, dwarf::DW_FORM_ref_sig8,
+                     new (DIEValueAllocator) DIETypeSignature(Sig->second));
+      continue;
+    }
+    Clone.addValue(Attr, dwarf::DW_FORM_ref4,
+                   new (DIEValueAllocator) DIEEntry(getClone(*Target)));
+  }
+}
+
+DIE *TypeUnitCloner::cloneType(const DIE &Ty) {
+  DIE *Clone = cloneTree(Ty);
+  getScope(*Ty.getParent())->addChild(Clone);
+  while (!Worklist.empty()) {
+    std::pair<const DIE *, DIE *> Next = Worklist.pop_back_val();
+    cloneValues(*Next.first, *Next.second);
+  }
+  return Clone;
+}
+
+/// Turn the DIE into a declaration, keeping only its name.
+static void makeDeclaration(CompileUnit *CU, DIE &Die) {
+  SmallVector<DIEAttrValue, 1> Name;
+  const SmallVectorImpl<DIEAttrValue> &Values = Die.getValues();
+  for (unsigned i = 0, e = Values.size(); i != e; ++i)
+    if (Values[i].getAttribute() == dwarf::DW_AT_name)
+      Name.push_back(Values[i]);
+  Die.clearValues();
+  if (!Name.empty())
+    Die.addValue(dwarf::DW_AT_name, Name[0].getForm(), Name[0].getValue());
+  CU->addFlag(&Die, dwarf::DW_AT_declaration);
+}
+
+/// Reattach the children of a split out type that are still referred to from
+/// its compile unit, and delete the others. Children that are only kept on the
+/// way to such DIEs are left as declarations.
+static void pruneSplitType(CompileUnit *CU, DIE &Parent,
+                           const SmallPtrSet<const DIE *, 64> &Referenced,
+                           const SmallPtrSet<const DIE *, 64> &Kept) {
+  std::vector<DIE *> Children;
+  Parent.takeChildren(Children);
+  for (unsigned i = 0, e = Children.size(); i != e; ++i) {
+    DIE *Child = Children[i];
+    if (!Kept.count(Child)) {
+      delete Child;
+      continue;
+    }
+    Parent.addChild(Child);
+    if (Referenced.count(Child))
+      continue;
+    makeDeclaration(CU, *Child);
+    pruneSplitType(CU, *Child, Referenced, Kept);
+  }
+}
+
+/// Note the DIEs in \p Inner that \p Die refers to.
+static void
+collectInnerReferences(const DIE &Die, const SmallPtrSet<const DIE *, 64> &Inner,
+                       SmallPtrSet<const DIE *, 64> &Referenced,
+                       SmallVectorImpl<const DIE *> &Worklist) {
+  const SmallVectorImpl<DIEAttrValue> &Values = Die.getValues();
+  for (unsigned i = 0, e = Values.size(); i != e; ++i)
+    if (const DIEEntry *E = dyn_cast<DIEEntry>(Values[i].getValue()))
+      if (Inner.count(E->getEntry()) && Referenced.insert(E->getEntry()))
+        Worklist.push_back(E->getEntry());
+}
+
+void DwarfDebug::constructTypeUnits() {
+  // Type units need DWARF4 forms and COMDAT sections, and the split DWARF and
+  // accelerator table emission do not know about them.
+  if (!GenerateTypeUnits || DwarfVersion < 4 || useSplitDwarf() ||
+      useDwarfAccelTables())
+    return;
+
+  // Pick the named C++ types at namespace scope.
+  SmallVector<DIE *, 16> Types;
+  SmallPtrSet<const DIE *, 16> Split;
+  for (unsigned i = 0, e = TypeUnits.size(); i != e; ++i) {
+    DIE *Die = TypeUnits[i];
+    const DIE *CUDie = Die->getCompileUnitOrNull();
+    CompileUnit *CU = CUDie ? CUDieMap.lookup(CUDie) : 0;
+    if (CU && shouldAddODRHash(CU, Die) && isNamespaceScoped(Die) &&
+        !Die->findAttribute(dwarf::DW_AT_declaration) && Split.insert(Die))
+      Types.push_back(Die);
+  }
+  TypeUnits.clear();
+
+  // Drop the types that are not self-contained. A type that depends on a
+  // dropped one has to copy it in, so repeat until nothing changes.
+  for (bool Changed = true; Changed;) {
+    Changed = false;
+    for (unsigned i = 0; i != Types.size();) {
+      if (isSelfContainedType(Types[i], Split)) {
+        ++i;
+        continue;
+      }
+      Split.erase(Types[i]);
+      Types.erase(Types.begin() + i);
+      Changed = true;
+    }
+  }
+  if (Types.empty())
+    return;
+
+  // Compute all of the signatures before any type is taken apart.
+  const TargetLoweringObjectFile &TLOF = Asm->getObjFileLowering();
+  DenseMap<const DIE *, uint64_t> Signatures;
+  for (unsigned i = 0, e = Types.size(); i != e; ++i) {
+    DIEHash Hash;
+    uint64_t Signature = Hash.computeTypeSignature(*Types[i]);
+    if (!TLOF.getDwarfTypesSection(Signature))
+      return;
+    Signatures[Types[i]] = Signature;
+  }
+
+  // Copy each type into a unit of its own; a type found in several compile
+  // units only needs one.
+  DIEInteger *FlagPresent = new (DIEValueAllocator) DIEInteger(1);
+  SmallPtrSet<const DIE *, 64> Inner;
+  std::set<uint64_t> Emitted;
+  for (unsigned i = 0, e = Types.size(); i != e; ++i) {
+    DIE *Ty = Types[i];
+    uint64_t Signature = Signatures[Ty];
+
+    SmallVector<const DIE *, 32> Worklist(Ty->getChildren().begin(),
+                                          Ty->getChildren().end());
+    while (!Worklist.empty()) {
+      const DIE *Die = Worklist.pop_back_val();
+      Inner.insert(Die);
+      Worklist.append(Die->getChildren().begin(), Die->getChildren().end());
+    }
+
+    if (!Emitted.insert(Signature).second)
+      continue;
+
+    const DIE *CUDie = Ty->getCompileUnit();
+    DIE *UnitDie = new DIE(dwarf::DW_TAG_type_unit);
+    copyAttribute(*CUDie, *UnitDie, dwarf::DW_AT_language);
+    copyAttribute(*CUDie, *UnitDie, dwarf::DW_AT_stmt_list);
+    TypeUnitCloner Cloner(DIEValueAllocator, Signatures, UnitDie, FlagPresent);
+    DIE *Type = Cloner.cloneType(*Ty);
+    DwarfTypeUnits.push_back(DwarfTypeUnit(UnitDie, Type, Signature,
+                                           TLOF.getDwarfTypesSection(Signature)));
+    ++NumTypeUnits;
+  }
+
+  // Whatever inside the split out types the compile units still refer to stays
+  // behind, along with everything it refers to in turn.
+  SmallPtrSet<const DIE *, 64> Referenced;
+  SmallVector<const DIE *, 64> Worklist;
+  for (DenseMap<const MDNode *, CompileUnit *>::iterator I = CUMap.begin(),
+                                                         E = CUMap.end();
+       I != E; ++I) {
+    CompileUnit *CU = I->second;
+    SmallVector<const DIE *, 64> Dies(1, CU->getCUDie());
+    while (!Dies.empty()) {
+      const DIE *Die = Dies.pop_back_val();
+      if (Split.count(Die))
+        continue;
+      collectInnerReferences(*Die, Inner, Referenced, Worklist);
+      Dies.append(Die->getChildren().begin(), Die->getChildren().end());
+    }
+    const StringMap<DIE *> *Maps[] = { &CU->getGlobalNames(),
+                                       &CU->getGlobalTypes() };
+    for (unsigned M = 0; M != array_lengthof(Maps); ++M)
+      for (StringMap<DIE *>::const_iterator GI = Maps[M]->begin(),
+                                            GE = Maps[M]->end();
+           GI != GE; ++GI)
+        if (Inner.count(GI->second) && Referenced.insert(GI->second))
+          Worklist.push_back(GI->second);
+  }
+  while (!Worklist.empty()) {
+    const DIE *Die = Worklist.pop_back_val();
+    collectInnerReferences(*Die, Inner, Referenced, Worklist);
+    const std::vector<DIE *> &Children = Die->getChildren();
+    for (unsigned i = 0, e = Children.size(); i != e; ++i)
+      if (Referenced.insert(Children[i]))
+        Worklist.push_back(Children[i]);
+  }
+  SmallPtrSet<const DIE *, 64> Kept;
+  for (SmallPtrSet<const DIE *, 64>::iterator I = Referenced.begin(),
+                                              E = Referenced.end();
+       I != E; ++I)
+    for (const DIE *Die = *I; !Split.count(Die) && Kept.insert(Die);)
+      Die = Die->getParent();
+
+  // Leave a declaration that refers to the type unit in place of each type.
+  for (unsigned i = 0, e = Types.size(); i != e; ++i) {
+    DIE *Ty = Types[i];
+    CompileUnit *CU = CUDieMap.lookup(Ty->getCompileUnit());
+    makeDeclaration(CU, *Ty);
+    Ty->addValue(dwarf::DW_AT_signature, dwarf::DW_FORM_ref_sig8,
+                 new (DIEValueAllocator) DIETypeSignature(Signatures[Ty]));
+    pruneSplitType(CU, *Ty, Referenced, Kept);
+  }
+}
+
 void DwarfDebug::finalizeModuleInfo() {
   // Collect info for variables that were optimized out.
   collectDeadVariables();
@@ -1088,10 +1480,18 @@ void DwarfDebug::finalizeModuleInfo() {
     }
   }
 
+  // Split complete types out into type units now that they are finished.
+  constructTypeUnits();
+
   // Compute DIE offsets and sizes.
   InfoHolder.computeSizeAndOffsets();
   if (useSplitDwarf())
     SkeletonHolder.computeSizeAndOffsets();
+
+  // Type unit offsets are relative to the start of the unit as well.
+  for (unsigned i = 0, e = DwarfTypeUnits.size(); i != e; ++i)
+    InfoHolder.computeSizeAndOffset(DwarfTypeUnits[i].UnitDie,
+                                    sizeof(int32_t) + TypeUnitHeaderSize);
 }
 
 void DwarfDebug::endSections() {
@@ -1161,6 +1561,9 @@ void DwarfDebug::endModule() {
     // Emit all the DIEs into a debug info section.
     emitDebugInfo();
 
+    // Emit the type units into their own sections.
+    emitDebugTypes();
+
     // Corresponding abbreviations into a abbrev section.
     emitAbbreviations();
 
@@ -1224,6 +1627,9 @@ void DwarfDebug::endModule() {
 
   // clean up.
   SPMap.clear();
+  for (unsigned i = 0, e = DwarfTypeUnits.size(); i != e; ++i)
+    delete DwarfTypeUnits[i].UnitDie;
+  DwarfTypeUnits.clear();
   for (DenseMap<const MDNode *, CompileUnit *>::iterator I = CUMap.begin(),
          E = CUMap.end(); I != E; ++I)
     delete I->second;
@@ -1930,11 +2336,10 @@ DwarfUnits::computeSizeAndOffset(DIE *Die, unsigned Offset) {
   const std::vector<DIE *> &Children = Die->getChildren();
 
   // Record the abbreviation.
-  assignAbbrevNumber(Die->getAbbrev());
+  assignAbbrevNumber(*Die);
 
   // Get the abbreviation for this DIE.
   unsigned AbbrevNumber = Die->getAbbrevNumber();
-  const DIEAbbrev *Abbrev = Abbreviations[AbbrevNumber - 1];
 
   // Set DIE offset
   Die->setOffset(Offset);
@@ -1942,19 +2347,15 @@ DwarfUnits::computeSizeAndOffset(DIE *Die, unsigned Offset) {
   // Start the size with the size of abbreviation code.
   Offset += MCAsmInfo::getULEB128Size(AbbrevNumber);
 
-  const SmallVectorImpl<DIEValue*> &Values = Die->getValues();
-  const SmallVectorImpl<DIEAbbrevData> &AbbrevData = Abbrev->getData();
+  const SmallVectorImpl<DIEAttrValue> &Values = Die->getValues();
 
   // Size the DIE attribute values.
   for (unsigned i = 0, N = Values.size(); i < N; ++i)
     // Size attribute value.
-    Offset += Values[i]->SizeOf(Asm, AbbrevData[i].getForm());
+    Offset += Values[i].getValue()->SizeOf(Asm, Values[i].getForm());
 
   // Size the DIE children if any.
   if (!Children.empty()) {
-    assert(Abbrev->getChildrenFlag() == dwarf::DW_CHILDREN_yes &&
-           "Children flag not set");
-
     for (unsigned j = 0, M = Children.size(); j < M; ++j)
       Offset = computeSizeAndOffset(Children[j], Offset);
 
@@ -2051,14 +2452,13 @@ void DwarfDebug::emitDIE(DIE *Die, ArrayRef<DIEAbbrev *> Abbrevs) {
                                 dwarf::TagString(Abbrev->getTag()));
   Asm->EmitULEB128(AbbrevNumber);
 
-  const SmallVectorImpl<DIEValue*> &Values = Die->getValues();
-  const SmallVectorImpl<DIEAbbrevData> &AbbrevData = Abbrev->getData();
+  const SmallVectorImpl<DIEAttrValue> &Values = Die->getValues();
 
   // Emit the DIE attribute values.
   for (unsigned i = 0, N = Values.size(); i < N; ++i) {
-    dwarf::Attribute Attr = AbbrevData[i].getAttribute();
-    dwarf::Form Form = AbbrevData[i].getForm();
-    assert(Form && "Too many attributes for DIE (check abbreviation)");
+    dwarf::Attribute Attr = Values[i].getAttribute();
+    dwarf::Form Form = Values[i].getForm();
+    DIEValue *Value = Values[i].getValue();
 
     if (Asm->isVerbose())
       Asm->OutStreamer.AddComment(dwarf::AttributeString(Attr));
@@ -2070,7 +2470,12 @@ void DwarfDebug::emitDIE(DIE *Die, ArrayRef<DIEAbbrev *> Abbrevs) {
     case dwarf::DW_AT_specification:
     case dwarf::DW_AT_import:
     case dwarf::DW_AT_containing_type: {
-      DIEEntry *E = cast<DIEEntry>(Values[i]);
+      // References to types that live in a type unit go by signature.
+      if (Form == dwarf::DW_FORM_ref_sig8) {
+        Value->EmitValue(Asm, Form);
+        break;
+      }
+      DIEEntry *E = cast<DIEEntry>(Value);
       DIE *Origin = E->getEntry();
       unsigned Addr = Origin->getOffset();
       if (Form == dwarf::DW_FORM_ref_addr) {
@@ -2098,7 +2503,7 @@ void DwarfDebug::emitDIE(DIE *Die, ArrayRef<DIEAbbrev *> Abbrevs) {
     }
     case dwarf::DW_AT_ranges: {
       // DW_AT_range Value encodes offset in debug_range section.
-      DIEInteger *V = cast<DIEInteger>(Values[i]);
+      DIEInteger *V = cast<DIEInteger>(Value);
 
       if (Asm->MAI->doesDwarfUseRelocationsAcrossSections()) {
         Asm->EmitLabelPlusOffset(DwarfDebugRangeSectionSym,
@@ -2113,27 +2518,27 @@ void DwarfDebug::emitDIE(DIE *Die, ArrayRef<DIEAbbrev *> Abbrevs) {
       break;
     }
     case dwarf::DW_AT_location: {
-      if (DIELabel *L = dyn_cast<DIELabel>(Values[i])) {
+      if (DIELabel *L = dyn_cast<DIELabel>(Value)) {
         if (Asm->MAI->doesDwarfUseRelocationsAcrossSections())
           Asm->EmitSectionOffset(L->getValue(), DwarfDebugLocSectionSym);
         else
           Asm->EmitLabelDifference(L->getValue(), DwarfDebugLocSectionSym, 4);
       } else {
-        Values[i]->EmitValue(Asm, Form);
+        Value->EmitValue(Asm, Form);
       }
       break;
     }
     case dwarf::DW_AT_accessibility: {
       if (Asm->isVerbose()) {
-        DIEInteger *V = cast<DIEInteger>(Values[i]);
+        DIEInteger *V = cast<DIEInteger>(Value);
         Asm->OutStreamer.AddComment(dwarf::AccessibilityString(V->getValue()));
       }
-      Values[i]->EmitValue(Asm, Form);
+      Value->EmitValue(Asm, Form);
       break;
     }
     default:
       // Emit an attribute using the defined form.
-      Values[i]->EmitValue(Asm, Form);
+      Value->EmitValue(Asm, Form);
       break;
     }
   }
@@ -2189,6 +2594,31 @@ void DwarfDebug::emitDebugInfo() {
                    DwarfAbbrevSectionSym);
 }
 
+// Emit the type units, each into the COMDAT section of its signature.
+void DwarfDebug::emitDebugTypes() {
+  const MCSection *ASection = Asm->getObjFileLowering().getDwarfAbbrevSection();
+  for (unsigned i = 0, e = DwarfTypeUnits.size(); i != e; ++i) {
+    const DwarfTypeUnit &TU = DwarfTypeUnits[i];
+    Asm->OutStreamer.SwitchSection(TU.Section);
+
+    Asm->OutStreamer.AddComment("Length of Unit");
+    Asm->EmitInt32(TypeUnitHeaderSize + TU.UnitDie->getSize());
+    Asm->OutStreamer.AddComment("DWARF version number");
+    Asm->EmitInt16(getDwarfVersion());
+    Asm->OutStreamer.AddComment("Offset Into Abbrev. Section");
+    Asm->EmitSectionOffset(Asm->GetTempSymbol(ASection->getLabelBeginName()),
+                           DwarfAbbrevSectionSym);
+    Asm->OutStreamer.AddComment("Address Size (in bytes)");
+    Asm->EmitInt8(Asm->getDataLayout().getPointerSize());
+    Asm->OutStreamer.AddComment("Type Signature");
+    Asm->OutStreamer.EmitIntValue(TU.Signature, sizeof(uint64_t));
+    Asm->OutStreamer.AddComment("Type DIE Offset");
+    Asm->EmitInt32(TU.Type->getOffset());
+
+    emitDIE(TU.UnitDie, Abbreviations);
+  }
+}
+
 // Emit the abbreviation section.
 void DwarfDebug::emitAbbreviations() {
   if (!useSplitDwarf())
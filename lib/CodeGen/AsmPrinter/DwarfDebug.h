@@ -228,6 +228,10 @@ class DwarfUnits {
   // A list of all the unique abbreviations in use.
   std::vector<DIEAbbrev *> &Abbreviations;
 
+  // The unique abbreviations are allocated through this allocator; DIEs only
+  // record the number of theirs.
+  BumpPtrAllocator &AbbrevAllocator;
+
   // A pointer to all units in the section.
   SmallVector<CompileUnit *, 1> CUs;
 
@@ -251,9 +255,11 @@ public:
   DwarfUnits(AsmPrinter *AP, FoldingSet<DIEAbbrev> *AS,
              std::vector<DIEAbbrev *> &A, const char *Pref,
              BumpPtrAllocator &DA)
-      : Asm(AP), AbbreviationsSet(AS), Abbreviations(A), StringPool(DA),
-        NextStringPoolNumber(0), StringPref(Pref), AddressPool(),
-        NextAddrPoolNumber(0) {}
+      : Asm(AP), AbbreviationsSet(AS), Abbreviations(A), AbbrevAllocator(DA),
+        StringPool(DA), NextStringPoolNumber(0), StringPref(Pref),
+        AddressPool(), NextAddrPoolNumber(0) {}
+
+  ~DwarfUnits();
 
   /// \brief Compute the size and offset of a DIE given an incoming Offset.
   unsigned computeSizeAndOffset(DIE *Die, unsigned Offset);
@@ -261,8 +267,9 @@ public:
   /// \brief Compute the size and offset of all the DIEs.
   void computeSizeAndOffsets();
 
-  /// \brief Define a unique number for the abbreviation.
-  void assignAbbrevNumber(DIEAbbrev &Abbrev);
+  /// \brief Define a unique number for the abbreviation of the DIE, interning
+  /// the abbreviation if it has not been seen before.
+  void assignAbbrevNumber(DIE &Die);
 
   /// \brief Add a unit to the list of CUs.
   void addUnit(CompileUnit *CU) { CUs.push_back(CU); }
@@ -309,6 +316,19 @@ struct SymbolCU {
   CompileUnit *CU;
 };
 
+/// \brief A type split out of its compile unit: the DW_TAG_type_unit DIE that
+/// holds a copy of the type and everything it refers to, which is emitted
+/// into a COMDAT section of its own keyed by the type signature.
+struct DwarfTypeUnit {
+  DwarfTypeUnit(DIE *UnitDie, DIE *Type, uint64_t Signature,
+                const MCSection *Section)
+      : UnitDie(UnitDie), Type(Type), Signature(Signature), Section(Section) {}
+  DIE *UnitDie;
+  DIE *Type;
+  uint64_t Signature;
+  const MCSection *Section;
+};
+
 /// \brief Collects and handles dwarf debug information.
 class DwarfDebug {
   // Target of Dwarf emission.
@@ -445,6 +465,9 @@ class DwarfDebug {
   // Holder for types that are going to be extracted out into a type unit.
   std::vector<DIE *> TypeUnits;
 
+  // The type units built from them, owning their unit DIEs.
+  std::vector<DwarfTypeUnit> DwarfTypeUnits;
+
   // Whether to emit the pubnames/pubtypes sections.
   bool HasDwarfPubSections;
 
@@ -520,6 +543,11 @@ private:
   /// \brief Collect info for variables that were optimized out.
   void collectDeadVariables();
 
+  /// \brief Move the complete C++ types collected by addTypeUnitType out of
+  /// their compile units into type units, leaving declarations that refer to
+  /// them by signature behind.
+  void constructTypeUnits();
+
   /// \brief Finish off debug information after all functions have been
   /// processed.
   void finalizeModuleInfo();
@@ -534,6 +562,9 @@ private:
   /// \brief Emit the debug info section.
   void emitDebugInfo();
 
+  /// \brief Emit the type units into their .debug_types sections.
+  void emitDebugTypes();
+
   /// \brief Emit the abbreviation section.
   void emitAbbreviations();
 
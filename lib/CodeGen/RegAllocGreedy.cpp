@@ -49,6 +49,12 @@ using namespace llvm;
 STATISTIC(NumGlobalSplits, "Number of split global live ranges");
 STATISTIC(NumLocalSplits,  "Number of split local live ranges");
 STATISTIC(NumEvicted,      "Number of interferences evicted");
+STATISTIC(NumCascades,     "Number of eviction cascades started");
+STATISTIC(NumEvictChecks,  "Number of physregs checked for eviction");
+STATISTIC(NumRegionCands,  "Number of region split candidates evaluated");
+STATISTIC(NumRegionGrowth, "Number of region growing steps");
+STATISTIC(NumEvictBudget,  "Number of evictions denied by the eviction budget");
+STATISTIC(NumSplitBudget,  "Number of splits denied by the split budget");
 
 static cl::opt<SplitEditor::ComplementSpillMode>
 SplitSpillMode("split-spill-mode", cl::Hidden,
@@ -59,6 +65,18 @@ SplitSpillMode("split-spill-mode", cl::Hidden,
              clEnumValEnd),
   cl::init(SplitEditor::SM_Partition));
 
+static cl::opt<unsigned>
+EvictionBudget("greedy-eviction-budget", cl::Hidden,
+  cl::desc("Maximum number of evictions per function before only urgent "
+           "evictions are allowed (0 = unlimited)"),
+  cl::init(0));
+
+static cl::opt<unsigned>
+SplitBudget("greedy-split-budget", cl::Hidden,
+  cl::desc("Maximum number of live range splitting attempts per function "
+           "before spilling instead (0 = unlimited)"),
+  cl::init(0));
+
 static RegisterRegAlloc greedyRegAlloc("greedy", "greedy register allocator",
                                        createGreedyRegisterAllocator);
 
@@ -84,6 +102,11 @@ class RAGreedy : public MachineFunctionPass,
   std::priority_queue<std::pair<unsigned, unsigned> > Queue;
   unsigned NextCascade;
 
+  // Work done in the current function, checked against EvictionBudget and
+  // SplitBudget.
+  unsigned NumFunctionEvictions;
+  unsigned NumFunctionSplits;
+
   // Live ranges pass through a number of stages as we try to allocate them.
   // Some of the stages may also create new live ranges:
   //
@@ -265,6 +288,7 @@ private:
   void calcGapWeights(unsigned, SmallVectorImpl<float>&);
   unsigned canReassign(LiveInterval &VirtReg, unsigned PhysReg);
   bool shouldEvict(LiveInterval &A, bool, LiveInterval &B, bool);
+  bool isEvictionBudgetSpent(LiveInterval&);
   bool canEvictInterference(LiveInterval&, unsigned, bool, EvictionCost&);
   void evictInterference(LiveInterval&, unsigned,
                          SmallVectorImpl<unsigned>&);
@@ -469,7 +493,7 @@ unsigned RAGreedy::tryAssign(LiveInterval &VirtReg,
   // If we missed a simple hint, try to cheaply evict interference from the
   // preferred register.
   if (unsigned Hint = MRI->getSimpleHint(VirtReg.reg))
-    if (Order.isHint(Hint)) {
+    if (Order.isHint(Hint) && !isEvictionBudgetSpent(VirtReg)) {
       DEBUG(dbgs() << "missed hint " << PrintReg(Hint, TRI) << '\n');
       EvictionCost MaxCost(1);
       if (canEvictInterference(VirtReg, Hint, true, MaxCost)) {
@@ -546,6 +570,17 @@ bool RAGreedy::shouldEvict(LiveInterval &A, bool IsHint,
   return A.weight > B.weight;
 }
 
+/// isEvictionBudgetSpent - Return true if the eviction budget for the current
+/// function is spent and VirtReg may not evict anything. Unspillable live
+/// ranges may always evict; they cannot make progress any other way.
+bool RAGreedy::isEvictionBudgetSpent(LiveInterval &VirtReg) {
+  if (!EvictionBudget || NumFunctionEvictions < EvictionBudget ||
+      !VirtReg.isSpillable())
+    return false;
+  ++NumEvictBudget;
+  return true;
+}
+
 /// canEvictInterference - Return true if all interferences between VirtReg and
 /// PhysReg can be evicted.  When OnlyCheap is set, don't do anything
 ///
@@ -561,6 +596,7 @@ bool RAGreedy::canEvictInterference(LiveInterval &VirtReg, unsigned PhysReg,
   if (Matrix->checkInterference(VirtReg, PhysReg) > LiveRegMatrix::IK_VirtReg)
     return false;
 
+  ++NumEvictChecks;
   bool IsLocal = LIS->intervalIsInOneMBB(VirtReg);
 
   // Find VirtReg's cascade number. This will be unassigned if VirtReg was never
@@ -643,8 +679,10 @@ void RAGreedy::evictInterference(LiveInterval &VirtReg, unsigned PhysReg,
   // number to every evicted register. These live ranges than then only be
   // evicted by a newer cascade, preventing infinite loops.
   unsigned Cascade = ExtraRegInfo[VirtReg.reg].Cascade;
-  if (!Cascade)
+  if (!Cascade) {
     Cascade = ExtraRegInfo[VirtReg.reg].Cascade = NextCascade++;
+    ++NumCascades;
+  }
 
   DEBUG(dbgs() << "evicting " << PrintReg(PhysReg, TRI)
                << " interference: Cascade " << Cascade << '\n');
@@ -670,6 +708,7 @@ void RAGreedy::evictInterference(LiveInterval &VirtReg, unsigned PhysReg,
            "Cannot decrease cascade number, illegal eviction");
     ExtraRegInfo[Intf->reg].Cascade = Cascade;
     ++NumEvicted;
+    ++NumFunctionEvictions;
     NewVRegs.push_back(Intf->reg);
   }
 }
@@ -684,6 +723,9 @@ unsigned RAGreedy::tryEvict(LiveInterval &VirtReg,
                             unsigned CostPerUseLimit) {
   NamedRegionTimer T("Evict", TimerGroupName, TimePassesIsEnabled);
 
+  if (isEvictionBudgetSpent(VirtReg))
+    return 0;
+
   // Keep track of the cheapest interference seen so far.
   EvictionCost BestCost(~0u);
   unsigned BestPhys = 0;
@@ -903,6 +945,7 @@ void RAGreedy::growRegion(GlobalSplitCandidate &Cand) {
       // liveness on loop backedges.
       SpillPlacer->addPrefSpill(NewBlocks, /* Strong= */ true);
     AddedTo = ActiveBlocks.size();
+    ++NumRegionGrowth;
 
     // Perhaps iterating can enable more bundles?
     SpillPlacer->iterate();
@@ -1213,6 +1256,7 @@ unsigned RAGreedy::tryRegionSplit(LiveInterval &VirtReg, AllocationOrder &Order,
       GlobalCand.resize(NumCands+1);
     GlobalSplitCandidate &Cand = GlobalCand[NumCands];
     Cand.reset(IntfCache, PhysReg);
+    ++NumRegionCands;
 
     SpillPlacer->prepare(Cand.LiveBundles);
     BlockFrequency Cost;
@@ -1721,6 +1765,13 @@ unsigned RAGreedy::trySplit(LiveInterval &VirtReg, AllocationOrder &Order,
   if (getStage(VirtReg) >= RS_Spill)
     return 0;
 
+  // Once the split budget is spent, let the caller spill VirtReg instead.
+  if (SplitBudget && NumFunctionSplits >= SplitBudget) {
+    ++NumSplitBudget;
+    return 0;
+  }
+  ++NumFunctionSplits;
+
   // Local intervals are handled separately.
   if (LIS->intervalIsInOneMBB(VirtReg)) {
     NamedRegionTimer T("Local Splitting", TimerGroupName, TimePassesIsEnabled);
@@ -1847,6 +1898,8 @@ bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   ExtraRegInfo.clear();
   ExtraRegInfo.resize(MRI->getNumVirtRegs());
   NextCascade = 1;
+  NumFunctionEvictions = 0;
+  NumFunctionSplits = 0;
   IntfCache.init(MF, Matrix->getLiveUnions(), Indexes, LIS, TRI);
   GlobalCand.resize(32);  // This will grow as needed.
 
@@ -894,8 +894,16 @@ SelectionDAG::~SelectionDAG() {
 void SelectionDAG::allnodes_clear() {
   assert(&*AllNodes.begin() == &EntryNode);
   AllNodes.remove(AllNodes.begin());
-  while (!AllNodes.empty())
-    DeallocateNode(AllNodes.begin());
+  // Every node is going away and the caller drops all of the debug info
+  // along with them, so skip DeallocateNode's per-node SDDbgValue lookup and
+  // hand the memory straight back to the allocator for the next block.
+  while (!AllNodes.empty()) {
+    SDNode *N = AllNodes.remove(AllNodes.begin());
+    if (N->OperandsNeedDelete)
+      delete[] N->OperandList;
+    N->NodeType = ISD::DELETED_NODE;
+    NodeAllocator.Deallocate(N);
+  }
 }
 
 void SelectionDAG::clear() {
@@ -17,10 +17,12 @@
 #include "SelectionDAGBuilder.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/BranchProbabilityInfo.h"
 #include "llvm/Analysis/CFG.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/CodeGen/Analysis.h"
 #include "llvm/CodeGen/FastISel.h"
 #include "llvm/CodeGen/FunctionLoweringInfo.h"
 #include "llvm/CodeGen/GCMetadata.h"
@@ -45,6 +47,7 @@
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetInstrInfo.h"
@@ -63,6 +66,10 @@ STATISTIC(NumFastIselFailures, "Number of instructions fast isel failed on");
 STATISTIC(NumFastIselSuccess, "Number of instructions fast isel selected");
 STATISTIC(NumFastIselBlocks, "Number of blocks selected entirely by fast isel");
 STATISTIC(NumDAGBlocks, "Number of blocks selected using DAG");
+STATISTIC(NumTrivialBlocks, "Number of fall-through blocks selected without "
+                            "building a DAG");
+STATISTIC(NumDAGInsts, "Number of IR instructions lowered to a DAG");
+STATISTIC(NumDAGNodesBuilt, "Number of nodes in initial selection DAGs");
 STATISTIC(NumDAGIselRetries,"Number of times dag isel has to try another path");
 STATISTIC(NumEntryBlocks, "Number of entry blocks encountered");
 STATISTIC(NumFastIselFailLowerArguments,
@@ -155,6 +162,16 @@ static cl::opt<bool>
 EnableFastISelAbortArgs("fast-isel-abort-args", cl::Hidden,
           cl::desc("Enable abort calls when \"fast\" instruction selection "
                    "fails to lower a formal argument"));
+static cl::opt<bool>
+EnableFastISelReport("fast-isel-report", cl::Hidden,
+          cl::desc("Print which instructions the \"fast\" instruction "
+                   "selector missed and how much was left to SelectionDAG "
+                   "because of them"));
+
+static cl::opt<bool>
+DisableTrivialBlockISel("disable-trivial-block-isel", cl::Hidden,
+          cl::desc("Build a SelectionDAG even for blocks that only fall "
+                   "through to the next block"));
 
 static cl::opt<bool>
 UseMBPI("use-mbpi",
@@ -198,6 +215,49 @@ static const bool ViewDAGCombine1 = false,
                   ViewSUnitDAGs = false;
 #endif
 
+namespace llvm {
+/// FastISelMissReport - Tally, for -fast-isel-report, what FastISel missed
+/// and how many instructions SelectionDAG had to select in its place.
+class FastISelMissReport {
+  /// Misses - For every kind of missed instruction, how often it was missed
+  /// and how many instructions went to SelectionDAG as a result.
+  StringMap<std::pair<unsigned, unsigned> > Misses;
+
+public:
+  void addMiss(const Instruction *I, unsigned NumToDAG) {
+    std::string Kind = I->getOpcodeName();
+    if (const IntrinsicInst *II = dyn_cast<IntrinsicInst>(I))
+      Kind += std::string(" ") + Intrinsic::getName(II->getIntrinsicID());
+    std::pair<unsigned, unsigned> &Entry = Misses[Kind];
+    ++Entry.first;
+    Entry.second += NumToDAG;
+  }
+
+  void addArgumentMiss() {
+    ++Misses["<arguments>"].first;
+  }
+
+  void print(raw_ostream &OS) const {
+    // Most expensive first, then alphabetically.
+    typedef std::pair<unsigned, StringRef> Line;
+    SmallVector<Line, 32> Lines;
+    for (StringMap<std::pair<unsigned, unsigned> >::const_iterator
+           I = Misses.begin(), E = Misses.end(); I != E; ++I)
+      Lines.push_back(Line(~I->getValue().second, I->getKey()));
+    std::sort(Lines.begin(), Lines.end());
+
+    OS << "===" << std::string(73, '-') << "===\n"
+       << "                          FastISel miss report\n"
+       << "===" << std::string(73, '-') << "===\n"
+       << "  Misses  Insts to DAG  Instruction\n";
+    for (unsigned I = 0, E = Lines.size(); I != E; ++I)
+      OS << format("%8u  %12u  ", Misses.lookup(Lines[I].second).first,
+                   ~Lines[I].first)
+         << Lines[I].second << '\n';
+  }
+};
+}
+
 //===---------------------------------------------------------------------===//
 ///
 /// RegisterScheduler class - Track the registration of instruction schedulers.
@@ -322,6 +382,7 @@ SelectionDAGISel::SelectionDAGISel(TargetMachine &tm,
   SDB(new SelectionDAGBuilder(*CurDAG, *FuncInfo, OL)),
   GFI(),
   OptLevel(OL),
+  MissReport(0),
   DAGSize(0) {
     initializeGCModuleInfoPass(*PassRegistry::getPassRegistry());
     initializeAliasAnalysisAnalysisGroup(*PassRegistry::getPassRegistry());
@@ -333,6 +394,16 @@ SelectionDAGISel::~SelectionDAGISel() {
   delete SDB;
   delete CurDAG;
   delete FuncInfo;
+  delete MissReport;
+}
+
+bool SelectionDAGISel::doFinalization(Module &M) {
+  if (MissReport) {
+    MissReport->print(errs());
+    delete MissReport;
+    MissReport = 0;
+  }
+  return false;
 }
 
 void SelectionDAGISel::getAnalysisUsage(AnalysisUsage &AU) const {
@@ -569,21 +640,85 @@ bool SelectionDAGISel::runOnMachineFunction(MachineFunction &mf) {
 void SelectionDAGISel::SelectBasicBlock(BasicBlock::const_iterator Begin,
                                         BasicBlock::const_iterator End,
                                         bool &HadTailCall) {
-  // Lower all of the non-terminator instructions. If a call is emitted
-  // as a tail call, cease emitting nodes for this block. Terminators
-  // are handled below.
-  for (BasicBlock::const_iterator I = Begin; I != End && !SDB->HasTailCall; ++I)
-    SDB->visit(*I);
+  {
+    NamedRegionTimer T("DAG Building", "Instruction Selection and Scheduling",
+                       TimePassesIsEnabled);
+    // Lower all of the non-terminator instructions. If a call is emitted
+    // as a tail call, cease emitting nodes for this block. Terminators
+    // are handled below.
+    for (BasicBlock::const_iterator I = Begin;
+         I != End && !SDB->HasTailCall; ++I) {
+      SDB->visit(*I);
+      ++NumDAGInsts;
+    }
 
-  // Make sure the root of the DAG is up-to-date.
-  CurDAG->setRoot(SDB->getControlRoot());
-  HadTailCall = SDB->HasTailCall;
-  SDB->clear();
+    // Make sure the root of the DAG is up-to-date.
+    CurDAG->setRoot(SDB->getControlRoot());
+    HadTailCall = SDB->HasTailCall;
+    SDB->clear();
+  }
+  // Counting the node list walks it, so only do so when someone is looking.
+  if (AreStatisticsEnabled())
+    NumDAGNodesBuilt += CurDAG->allnodes_size();
 
   // Final step, emit the lowered DAG as machine code.
   CodeGenAndEmitDAG();
 }
 
+/// SelectTrivialBlock - A block that holds nothing but an unconditional
+/// branch to its layout successor lowers to no machine instructions at all,
+/// provided every PHI it feeds there takes a value that already lives in a
+/// virtual register. Record the CFG edge and the PHI inputs for such a block
+/// directly instead of building, combining, legalizing and scheduling an
+/// empty DAG. These are mostly loop preheaders and split critical edges that
+/// CodeGenPrepare keeps around because their successor has PHIs.
+bool SelectionDAGISel::SelectTrivialBlock(BasicBlock::const_iterator Begin) {
+  const BranchInst *Br = dyn_cast<BranchInst>(Begin);
+  if (!Br || !Br->isUnconditional())
+    return false;
+
+  const BasicBlock *LLVMBB = Br->getParent();
+  const BasicBlock *Succ = Br->getSuccessor(0);
+  MachineBasicBlock *SuccMBB = FuncInfo->MBBMap[Succ];
+  if (!FuncInfo->MBB->isLayoutSuccessor(SuccMBB))
+    return false;
+
+  // Constants and static allocas would need copies materialized in this
+  // block, which is the DAG's job.
+  for (BasicBlock::const_iterator I = Succ->begin();
+       const PHINode *PN = dyn_cast<PHINode>(I); ++I) {
+    if (PN->use_empty() || PN->getType()->isEmptyTy())
+      continue;
+    const Value *PHIOp = PN->getIncomingValueForBlock(LLVMBB);
+    if (isa<Constant>(PHIOp) || !FuncInfo->ValueMap.count(PHIOp))
+      return false;
+  }
+
+  // Mirror SelectionDAGBuilder::HandlePHINodesInSuccessorBlocks so that
+  // FinishBasicBlock wires the machine PHIs up exactly as it would after a
+  // DAG.
+  const TargetLowering *TLI = TM.getTargetLowering();
+  MachineBasicBlock::iterator MBBI = SuccMBB->begin();
+  for (BasicBlock::const_iterator I = Succ->begin();
+       const PHINode *PN = dyn_cast<PHINode>(I); ++I) {
+    if (PN->use_empty() || PN->getType()->isEmptyTy())
+      continue;
+    unsigned Reg = FuncInfo->ValueMap[PN->getIncomingValueForBlock(LLVMBB)];
+    SmallVector<EVT, 4> ValueVTs;
+    ComputeValueVTs(*TLI, PN->getType(), ValueVTs);
+    for (unsigned vti = 0, vte = ValueVTs.size(); vti != vte; ++vti) {
+      unsigned NumRegisters =
+        TLI->getNumRegisters(*CurDAG->getContext(), ValueVTs[vti]);
+      for (unsigned i = 0; i != NumRegisters; ++i)
+        FuncInfo->PHINodesToUpdate.push_back(std::make_pair(MBBI++, Reg + i));
+      Reg += NumRegisters;
+    }
+  }
+
+  FuncInfo->MBB->addSuccessor(SuccMBB);
+  return true;
+}
+
 void SelectionDAGISel::ComputeLiveOutVRegInfo() {
   SmallPtrSet<SDNode*, 128> VisitedNodes;
   SmallVector<SDNode*, 128> Worklist;
@@ -993,6 +1128,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
   FastISel *FastIS = 0;
   if (TM.Options.EnableFastISel)
     FastIS = getTargetLowering()->createFastISel(*FuncInfo, LibInfo);
+  if (FastIS && EnableFastISelReport && !MissReport)
+    MissReport = new FastISelMissReport();
 
   // Iterate over all basic blocks in the function.
   ReversePostOrderTraversal<const Function*> RPOT(&Fn);
@@ -1049,6 +1186,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
         if (!FastIS->LowerArguments()) {
           // Fast isel failed to lower these arguments
           ++NumFastIselFailLowerArguments;
+          if (MissReport)
+            MissReport->addArgumentMiss();
           if (EnableFastISelAbortArgs)
             llvm_unreachable("FastISel didn't lower all arguments");
 
@@ -1142,10 +1281,15 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
           // selection may have handled the call, input args, etc.
           unsigned RemainingNow = std::distance(Begin, BI);
           NumFastIselFailures += NumFastIselRemaining - RemainingNow;
+          if (MissReport)
+            MissReport->addMiss(Inst, 1 + NumFastIselRemaining - RemainingNow);
           NumFastIselRemaining = RemainingNow;
           continue;
         }
 
+        if (MissReport)
+          MissReport->addMiss(Inst, NumFastIselRemaining);
+
         if (isa<TerminatorInst>(Inst) && !isa<BranchInst>(Inst)) {
           // Don't abort, and use a different message for terminator misses.
           NumFastIselFailures += NumFastIselRemaining;
@@ -1173,12 +1317,15 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
       if (LLVMBB == &Fn.getEntryBlock()) {
         ++NumEntryBlocks;
         LowerArguments(Fn);
+      } else if (!DisableTrivialBlockISel && SelectTrivialBlock(Begin)) {
+        ++NumTrivialBlocks;
+        BI = Begin;
       }
     }
 
     if (Begin != BI)
       ++NumDAGBlocks;
-    else
+    else if (FastIS)
       ++NumFastIselBlocks;
 
     if (Begin != BI) {
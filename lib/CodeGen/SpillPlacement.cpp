@@ -30,6 +30,7 @@
 #define DEBUG_TYPE "spillplacement"
 #include "SpillPlacement.h"
 #include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/CodeGen/EdgeBundles.h"
 #include "llvm/CodeGen/MachineBasicBlock.h"
 #include "llvm/CodeGen/MachineBlockFrequencyInfo.h"
@@ -41,6 +42,9 @@
 
 using namespace llvm;
 
+STATISTIC(NumPlacements, "Number of spill placement problems solved");
+STATISTIC(NumIterations, "Number of spill placement network iterations");
+
 char SpillPlacement::ID = 0;
 INITIALIZE_PASS_BEGIN(SpillPlacement, "spill-code-placement",
                       "Spill Code Placement Analysis", true, true)
@@ -323,6 +327,7 @@ void SpillPlacement::iterate() {
   // affect the entire network in a single iteration. That means very fast
   // convergence, usually in a single iteration.
   for (unsigned iteration = 0; iteration != 10; ++iteration) {
+    ++NumIterations;
     // Scan backwards, skipping the last node which was just updated.
     bool Changed = false;
     for (SmallVectorImpl<unsigned>::const_reverse_iterator I =
@@ -354,6 +359,7 @@ void SpillPlacement::iterate() {
 }
 
 void SpillPlacement::prepare(BitVector &RegBundles) {
+  ++NumPlacements;
   Linked.clear();
   RecentPositive.clear();
   // Reuse RegBundles as our ActiveNodes vector.
@@ -365,7 +365,36 @@ DWARFCompileUnit *DWARFContext::getCompileUnitForAddress(uint64_t Address) {
   // First, get the offset of the compile unit.
   uint32_t CUOffset = getDebugAranges()->findAddress(Address);
   // Retrieve the compile unit.
-  return getCompileUnitForOffset(CUOffset);
+  DWARFCompileUnit *CU = getCompileUnitForOffset(CUOffset);
+  if (CU)
+    noteUnitUsed(CU);
+  return CU;
+}
+
+// Maximum number of compile units that keep their DIEs and line table parsed
+// between address queries.
+static const unsigned MaxParsedUnits = 8;
+
+void DWARFContext::noteUnitUsed(DWARFCompileUnit *CU) {
+  SmallVectorImpl<DWARFCompileUnit *>::iterator I =
+      std::find(ParsedUnits.begin(), ParsedUnits.end(), CU);
+  if (I == ParsedUnits.begin() && I != ParsedUnits.end())
+    return;
+  if (I != ParsedUnits.end())
+    ParsedUnits.erase(I);
+  ParsedUnits.insert(ParsedUnits.begin(), CU);
+  if (ParsedUnits.size() <= MaxParsedUnits)
+    return;
+
+  DWARFCompileUnit *Victim = ParsedUnits.pop_back_val();
+  const DWARFDebugInfoEntryMinimal *CUDie = Victim->getCompileUnitDIE();
+  if (Line && CUDie) {
+    unsigned stmtOffset =
+        CUDie->getAttributeValueAsSectionOffset(Victim, DW_AT_stmt_list, -1U);
+    if (stmtOffset != -1U)
+      Line->clearLineTable(stmtOffset);
+  }
+  Victim->releaseDIEs();
 }
 
 static bool getFileNameForCompileUnit(DWARFCompileUnit *CU,
@@ -644,6 +673,12 @@ DWARFContextInMemory::DWARFContextInMemory(object::ObjectFile *Obj) :
     RelSecName = RelSecName.substr(
         RelSecName.find_first_not_of("._")); // Skip . and _ prefixes.
 
+    // Relocations against a compressed section apply to its uncompressed
+    // contents.
+    bool RelocatedSectionIsCompressed = RelSecName.startswith("zdebug_");
+    if (RelocatedSectionIsCompressed)
+      RelSecName = RelSecName.substr(1);
+
     // TODO: Add support for relocations in other sections as needed.
     // Record relocations for the debug_info and debug_line sections.
     RelocAddrMap *Map = StringSwitch<RelocAddrMap*>(RelSecName)
@@ -663,6 +698,12 @@ DWARFContextInMemory::DWARFContextInMemory(object::ObjectFile *Obj) :
     if (i->begin_relocations() != i->end_relocations()) {
       uint64_t SectionSize;
       RelocatedSection->getSize(SectionSize);
+      if (RelocatedSectionIsCompressed) {
+        StringRef RelocatedData;
+        RelocatedSection->getContents(RelocatedData);
+        if (!consumeCompressedDebugSectionHeader(RelocatedData, SectionSize))
+          continue;
+      }
       for (object::relocation_iterator reloc_i = i->begin_relocations(),
              reloc_e = i->end_relocations();
            reloc_i != reloc_e; reloc_i.increment(ec)) {
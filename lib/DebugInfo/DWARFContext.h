@@ -39,6 +39,10 @@ class DWARFContext : public DIContext {
   SmallVector<DWARFCompileUnit *, 1> DWOCUs;
   OwningPtr<DWARFDebugAbbrev> AbbrevDWO;
 
+  /// Compile units whose DIEs and line tables were parsed to answer address
+  /// queries, most recently used first.
+  SmallVector<DWARFCompileUnit *, 8> ParsedUnits;
+
   DWARFContext(DWARFContext &) LLVM_DELETED_FUNCTION;
   DWARFContext &operator=(DWARFContext &) LLVM_DELETED_FUNCTION;
 
@@ -169,6 +173,11 @@ private:
   /// Return the compile unit which contains instruction with provided
   /// address.
   DWARFCompileUnit *getCompileUnitForAddress(uint64_t Address);
+
+  /// Mark the compile unit as most recently queried. Releases the DIEs and
+  /// the line table of the least recently queried unit once too many units
+  /// are parsed, so results of earlier queries must not be kept around.
+  void noteUnitUsed(DWARFCompileUnit *CU);
 };
 
 /// DWARFContextInMemory is the simplest possible implementation of a
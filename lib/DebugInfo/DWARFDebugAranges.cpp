@@ -36,6 +36,10 @@ void DWARFDebugAranges::extract(DataExtractor DebugArangesData) {
   for (RangeSetColl::const_iterator I = Sets.begin(), E = Sets.end(); I != E;
        ++I) {
     uint32_t CUOffset = I->getCompileUnitDIEOffset();
+    // This compile unit is described by .debug_aranges, there is no need to
+    // look at its DIEs in generate().
+    if (I->getNumDescriptors() > 0)
+      ParsedCUOffsets.insert(CUOffset);
 
     for (uint32_t i = 0, n = I->getNumDescriptors(); i < n; ++i) {
       const DWARFDebugArangeSet::Descriptor *ArangeDescPtr =
@@ -58,7 +62,8 @@ void DWARFDebugAranges::generate(DWARFContext *CTX) {
 
   // Generate aranges from DIEs: even if .debug_aranges section is present,
   // it may describe only a small subset of compilation units, so we need to
-  // manually build aranges for the rest of them.
+  // manually build aranges for the rest of them. This usually needs only the
+  // compile unit DIE, see DWARFUnit::buildAddressRangeTable().
   for (uint32_t i = 0, n = CTX->getNumCompileUnits(); i < n; ++i) {
     if (DWARFCompileUnit *CU = CTX->getCompileUnitAtIndex(i)) {
       uint32_t CUOffset = CU->getOffset();
@@ -239,6 +239,8 @@ public:
   const LineTable *getLineTable(uint32_t offset) const;
   const LineTable *getOrParseLineTable(DataExtractor debug_line_data,
                                        uint32_t offset);
+  /// Drop the cached line table at this offset, if any.
+  void clearLineTable(uint32_t offset) { LineTableMap.erase(offset); }
 
 private:
   typedef std::map<uint32_t, LineTable> LineTableMapTy;
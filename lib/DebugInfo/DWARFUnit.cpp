@@ -298,10 +298,48 @@ void DWARFUnit::clearDIEs(bool KeepCUDie) {
   }
 }
 
+void DWARFUnit::releaseDIEs() {
+  clearDIEs(true);
+  DWO.reset();
+}
+
+bool
+DWARFUnit::buildAddressRangeTableFromCUDie(DWARFDebugAranges *debug_aranges,
+                                           uint32_t CUOffsetInAranges) {
+  extractDIEsIfNeeded(true);
+  if (DieArray.empty())
+    return false;
+  const DWARFDebugInfoEntryMinimal &CUDie = DieArray[0];
+  uint32_t RangesOffset =
+      CUDie.getAttributeValueAsSectionOffset(this, DW_AT_ranges, -1U);
+  if (RangesOffset != -1U) {
+    DWARFDebugRangeList RangeList;
+    if (!extractRangeList(RangesOffset, RangeList))
+      return false;
+    std::vector<std::pair<uint64_t, uint64_t> > Ranges;
+    RangeList.getAbsoluteRanges(getBaseAddress(), Ranges);
+    for (size_t i = 0, n = Ranges.size(); i != n; ++i)
+      debug_aranges->appendRange(CUOffsetInAranges, Ranges[i].first,
+                                 Ranges[i].second);
+    return true;
+  }
+  uint64_t LowPC, HighPC;
+  if (!CUDie.getLowAndHighPC(this, LowPC, HighPC))
+    return false;
+  debug_aranges->appendRange(CUOffsetInAranges, LowPC, HighPC);
+  return true;
+}
+
 void
 DWARFUnit::buildAddressRangeTable(DWARFDebugAranges *debug_aranges,
                                          bool clear_dies_if_already_not_parsed,
                                          uint32_t CUOffsetInAranges) {
+  // Most producers describe the code of the whole compile unit in its DIE.
+  // Use that instead of walking all subprograms, so that looking up a single
+  // address doesn't require parsing every compile unit in the file.
+  if (buildAddressRangeTableFromCUDie(debug_aranges, CUOffsetInAranges))
+    return;
+
   // This function is usually called if there in no .debug_aranges section
   // in order to produce a compile unit level set of address ranges that
   // is accurate. If the DIEs weren't parsed, then we don't want all dies for
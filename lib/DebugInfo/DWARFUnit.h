@@ -134,6 +134,11 @@ public:
                               bool clear_dies_if_already_not_parsed,
                               uint32_t CUOffsetInAranges);
 
+  /// releaseDIEs - Drops all parsed DIEs except the compile unit DIE, as well
+  /// as the .dwo file for this unit, if it was opened. They are parsed again
+  /// on demand.
+  void releaseDIEs();
+
   /// getInlinedChainForAddress - fetches inlined chain for a given address.
   /// Returns empty chain if there is no subprogram containing address. The
   /// chain is valid as long as parsed compile unit DIEs are not cleared.
@@ -152,6 +157,11 @@ private:
   void setDIERelations();
   /// clearDIEs - Clear parsed DIEs to keep memory usage low.
   void clearDIEs(bool KeepCUDie);
+  /// buildAddressRangeTableFromCUDie - Appends address ranges described by
+  /// DW_AT_ranges or DW_AT_low_pc/DW_AT_high_pc of the compile unit DIE.
+  /// Returns false if the compile unit DIE doesn't describe its ranges.
+  bool buildAddressRangeTableFromCUDie(DWARFDebugAranges *debug_aranges,
+                                       uint32_t CUOffsetInAranges);
 
   /// parseDWO - Parses .dwo file for current compile unit. Returns true if
   /// it was actually constructed.
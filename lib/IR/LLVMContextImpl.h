@@ -230,6 +230,12 @@ public:
   virtual void allUsesReplacedWith(Value *VNew);
 };
   
+/// LLVMContextImpl - The private state of an LLVMContext.
+///
+/// None of the uniquing tables below are synchronized. Note that locking
+/// them would not by itself let two threads work on the same context: every
+/// use of a uniqued constant also links a Use into that constant's use list,
+/// so threads sharing a context would still race on the constants.
 class LLVMContextImpl {
 public:
   /// OwnedModules - The set of modules instantiated in this context, and which
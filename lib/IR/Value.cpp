@@ -310,6 +310,16 @@ void Value::replaceAllUsesWith(Value *New) {
   if (HasValueHandle)
     ValueHandleBase::ValueIsRAUWd(this, New);
 
+  // Only constants and basic blocks (through blockaddress) can be operands of
+  // other constants.  Uses of anything else can be moved over without finding
+  // their user, which means walking the waymarks of the user's operand list
+  // for every single use.
+  if (!isa<Constant>(this) && !isa<BasicBlock>(this)) {
+    while (!use_empty())
+      UseList->set(New);
+    return;
+  }
+
   while (!use_empty()) {
     Use &U = *UseList;
     // Must handle Constants specially, we cannot call replaceUsesOfWith on a
@@ -18,6 +18,7 @@
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/MC/MCAsmBackend.h"
+#include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCAsmLayout.h"
 #include "llvm/MC/MCAssembler.h"
 #include "llvm/MC/MCContext.h"
@@ -28,9 +29,12 @@
 #include "llvm/MC/MCObjectWriter.h"
 #include "llvm/MC/MCSectionELF.h"
 #include "llvm/MC/MCValue.h"
+#include "llvm/Support/Compression.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ELF.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <map>
 #include <vector>
 using namespace llvm;
 
@@ -49,11 +53,11 @@ class ELFObjectWriter : public MCObjectWriter {
     static bool isLocal(const MCSymbolData &Data, bool isSignature,
                         bool isUsedInReloc);
     static bool IsELFMetaDataSection(const MCSectionData &SD);
-    static uint64_t DataSectionSize(const MCSectionData &SD);
-    static uint64_t GetSectionFileSize(const MCAsmLayout &Layout,
-                                       const MCSectionData &SD);
-    static uint64_t GetSectionAddressSize(const MCAsmLayout &Layout,
-                                          const MCSectionData &SD);
+    uint64_t DataSectionSize(const MCSectionData &SD) const;
+    uint64_t GetSectionFileSize(const MCAsmLayout &Layout,
+                                const MCSectionData &SD) const;
+    uint64_t GetSectionAddressSize(const MCAsmLayout &Layout,
+                                   const MCSectionData &SD) const;
 
     void WriteDataSectionData(MCAssembler &Asm,
                               const MCAsmLayout &Layout,
@@ -87,8 +91,21 @@ class ELFObjectWriter : public MCObjectWriter {
 
     llvm::DenseMap<const MCSectionData*,
                    std::vector<ELFRelocationEntry> > Relocations;
+
+    /// RelocationSectionEntries - The sorted relocations of each relocation
+    /// section, keyed by that section. They are encoded straight into the
+    /// output stream when the section is written, by which point the data of
+    /// the sections they apply to has already been written and freed.
+    llvm::DenseMap<const MCSectionData*,
+                   std::vector<ELFRelocationEntry> > RelocationSectionEntries;
     DenseMap<const MCSection*, uint64_t> SectionStringTableIndex;
 
+    /// CompressedSections - The zlib-gnu contents ("ZLIB", the big-endian
+    /// 64-bit uncompressed size, then the zlib stream) of the debug sections
+    /// that are written compressed. Their fragments and relocations still
+    /// describe the uncompressed data, which is what the format expects.
+    std::map<const MCSectionData*, SmallString<0> > CompressedSections;
+
     /// @}
     /// @name Symbol Table Data
     /// @{
@@ -267,6 +284,9 @@ class ELFObjectWriter : public MCObjectWriter {
     // Map from a section to its offset
     typedef DenseMap<const MCSectionELF*, uint64_t> SectionOffsetMapTy;
 
+    // Map from a section to its size in memory
+    typedef DenseMap<const MCSectionELF*, uint64_t> SectionSizeMapTy;
+
     /// ComputeSymbolTable - Compute the symbol table data
     ///
     /// \param Asm - The assembler.
@@ -282,11 +302,12 @@ class ELFObjectWriter : public MCObjectWriter {
                          SectionIndexMapTy &SectionIndexMap,
                          const RelMapTy &RelMap);
 
+    void CompressDebugSections(MCAssembler &Asm, MCAsmLayout &Layout);
+
     void CreateRelocationSections(MCAssembler &Asm, MCAsmLayout &Layout,
                                   RelMapTy &RelMap);
 
-    void WriteRelocations(MCAssembler &Asm, MCAsmLayout &Layout,
-                          const RelMapTy &RelMap);
+    void SortRelocations(MCAssembler &Asm, const RelMapTy &RelMap);
 
     void CreateMetadataSections(MCAssembler &Asm, MCAsmLayout &Layout,
                                 SectionIndexMapTy &SectionIndexMap,
@@ -304,9 +325,9 @@ class ELFObjectWriter : public MCObjectWriter {
                                           const MCAsmLayout &Layout);
 
     void WriteSectionHeader(MCAssembler &Asm, const GroupMapTy &GroupMap,
-                            const MCAsmLayout &Layout,
                             const SectionIndexMapTy &SectionIndexMap,
-                            const SectionOffsetMapTy &SectionOffsetMap);
+                            const SectionOffsetMapTy &SectionOffsetMap,
+                            const SectionSizeMapTy &SectionSizeMap);
 
     void ComputeSectionOrder(MCAssembler &Asm,
                              std::vector<const MCSectionELF*> &Sections);
@@ -316,9 +337,8 @@ class ELFObjectWriter : public MCObjectWriter {
                           uint64_t Size, uint32_t Link, uint32_t Info,
                           uint64_t Alignment, uint64_t EntrySize);
 
-    void WriteRelocationsFragment(const MCAssembler &Asm,
-                                  MCDataFragment *F,
-                                  const MCSectionData *SD);
+    void WriteRelocationEntries(const MCAssembler &Asm,
+                                std::vector<ELFRelocationEntry> &Relocs);
 
     virtual bool
     IsSymbolRefDifferenceFullyResolvedImpl(const MCAssembler &Asm,
@@ -997,6 +1017,105 @@ void ELFObjectWriter::ComputeSymbolTable(MCAssembler &Asm,
     NeedsSymtabShndx = true;
 }
 
+/// getSectionContents - Gather the final bytes of a section from its
+/// fragments. Returns false if the section holds a fragment whose bytes are
+/// only produced while writing (code alignment, non-zero fills, .org).
+static bool getSectionContents(const MCAssembler &Asm,
+                               const MCAsmLayout &Layout,
+                               const MCSectionData &SD,
+                               SmallVectorImpl<char> &Contents) {
+  for (MCSectionData::const_iterator I = SD.begin(), E = SD.end(); I != E;
+       ++I) {
+    const MCFragment &F = *I;
+    switch (F.getKind()) {
+    case MCFragment::FT_Data:
+    case MCFragment::FT_Relaxable:
+    case MCFragment::FT_CompactEncodedInst: {
+      const SmallVectorImpl<char> &Data =
+        cast<MCEncodedFragment>(F).getContents();
+      Contents.append(Data.begin(), Data.end());
+      break;
+    }
+    case MCFragment::FT_LEB: {
+      const SmallString<8> &Data = cast<MCLEBFragment>(F).getContents();
+      Contents.append(Data.begin(), Data.end());
+      break;
+    }
+    case MCFragment::FT_Dwarf: {
+      const SmallString<8> &Data =
+        cast<MCDwarfLineAddrFragment>(F).getContents();
+      Contents.append(Data.begin(), Data.end());
+      break;
+    }
+    case MCFragment::FT_DwarfFrame: {
+      const SmallString<8> &Data =
+        cast<MCDwarfCallFrameFragment>(F).getContents();
+      Contents.append(Data.begin(), Data.end());
+      break;
+    }
+    case MCFragment::FT_Align: {
+      const MCAlignFragment &AF = cast<MCAlignFragment>(F);
+      if (AF.hasEmitNops() || AF.getValue() != 0)
+        return false;
+      Contents.append(Asm.computeFragmentSize(Layout, F), 0);
+      break;
+    }
+    case MCFragment::FT_Fill: {
+      const MCFillFragment &FF = cast<MCFillFragment>(F);
+      if (FF.getValue() != 0)
+        return false;
+      Contents.append(FF.getSize(), 0);
+      break;
+    }
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+void ELFObjectWriter::CompressDebugSections(MCAssembler &Asm,
+                                            MCAsmLayout &Layout) {
+  if (!Asm.getContext().getAsmInfo()->compressDebugSections())
+    return;
+
+  for (MCAssembler::iterator it = Asm.begin(), ie = Asm.end(); it != ie;
+       ++it) {
+    const MCSectionData &SD = *it;
+    const MCSectionELF &Section =
+      static_cast<const MCSectionELF&>(SD.getSection());
+    StringRef SectionName = Section.getSectionName();
+    if (!SectionName.startswith(".debug_"))
+      continue;
+
+    SmallString<128> Uncompressed;
+    if (!getSectionContents(Asm, Layout, SD, Uncompressed))
+      continue;
+    assert(Uncompressed.size() == Layout.getSectionFileSize(&SD) &&
+           "Section contents don't match its layout");
+
+    OwningPtr<MemoryBuffer> Compressed;
+    if (zlib::compress(Uncompressed, Compressed) != zlib::StatusOK)
+      continue;
+
+    // Like GNU as, keep the section as it is unless compressing it pays for
+    // the 12-byte header.
+    const unsigned HeaderSize = 12;
+    if (HeaderSize + Compressed->getBufferSize() >= Uncompressed.size())
+      continue;
+
+    SmallString<0> &Contents = CompressedSections[&SD];
+    Contents.reserve(HeaderSize + Compressed->getBufferSize());
+    Contents += "ZLIB";
+    for (int Shift = 56; Shift >= 0; Shift -= 8)
+      Contents.push_back(char(uint64_t(Uncompressed.size()) >> Shift));
+    Contents += Compressed->getBuffer();
+
+    Asm.getContext().renameELFSection(&Section,
+                                      (".z" + SectionName.substr(1)).str());
+  }
+}
+
 void ELFObjectWriter::CreateRelocationSections(MCAssembler &Asm,
                                                MCAsmLayout &Layout,
                                                RelMapTy &RelMap) {
@@ -1037,8 +1156,8 @@ void ELFObjectWriter::CreateRelocationSections(MCAssembler &Asm,
   }
 }
 
-void ELFObjectWriter::WriteRelocations(MCAssembler &Asm, MCAsmLayout &Layout,
-                                       const RelMapTy &RelMap) {
+void ELFObjectWriter::SortRelocations(MCAssembler &Asm,
+                                      const RelMapTy &RelMap) {
   for (MCAssembler::const_iterator it = Asm.begin(),
          ie = Asm.end(); it != ie; ++it) {
     const MCSectionData &SD = *it;
@@ -1051,8 +1170,12 @@ void ELFObjectWriter::WriteRelocations(MCAssembler &Asm, MCAsmLayout &Layout,
     MCSectionData &RelaSD = Asm.getOrCreateSectionData(*RelaSection);
     RelaSD.setAlignment(is64Bit() ? 8 : 4);
 
-    MCDataFragment *F = new MCDataFragment(&RelaSD);
-    WriteRelocationsFragment(Asm, F, &*it);
+    // Sort the relocation entries. Most targets just sort by r_offset, but
+    // some (e.g., MIPS) have additional constraints. This has to happen while
+    // the fixups the entries point to are still around.
+    std::vector<ELFRelocationEntry> &Relocs = Relocations[&SD];
+    TargetObjectWriter->sortRelocs(Asm, Relocs);
+    RelocationSectionEntries[&RelaSD].swap(Relocs);
   }
 }
 
@@ -1074,15 +1197,8 @@ void ELFObjectWriter::WriteSecHdrEntry(uint32_t Name, uint32_t Type,
   WriteWord(EntrySize); // sh_entsize
 }
 
-void ELFObjectWriter::WriteRelocationsFragment(const MCAssembler &Asm,
-                                               MCDataFragment *F,
-                                               const MCSectionData *SD) {
-  std::vector<ELFRelocationEntry> &Relocs = Relocations[SD];
-
-  // Sort the relocation entries. Most targets just sort by r_offset, but some
-  // (e.g., MIPS) have additional constraints.
-  TargetObjectWriter->sortRelocs(Asm, Relocs);
-
+void ELFObjectWriter::WriteRelocationEntries(const MCAssembler &Asm,
+                                       std::vector<ELFRelocationEntry> &Relocs) {
   for (unsigned i = 0, e = Relocs.size(); i != e; ++i) {
     ELFRelocationEntry entry = Relocs[e - i - 1];
 
@@ -1093,33 +1209,35 @@ void ELFObjectWriter::WriteRelocationsFragment(const MCAssembler &Asm,
     else
       entry.Index += FileSymbolData.size() + LocalSymbolData.size();
     if (is64Bit()) {
-      String64(*F, entry.r_offset);
+      Write64(entry.r_offset);
       if (TargetObjectWriter->isN64()) {
-        String32(*F, entry.Index);
+        Write32(entry.Index);
 
-        String8(*F, TargetObjectWriter->getRSsym(entry.Type));
-        String8(*F, TargetObjectWriter->getRType3(entry.Type));
-        String8(*F, TargetObjectWriter->getRType2(entry.Type));
-        String8(*F, TargetObjectWriter->getRType(entry.Type));
+        Write8(TargetObjectWriter->getRSsym(entry.Type));
+        Write8(TargetObjectWriter->getRType3(entry.Type));
+        Write8(TargetObjectWriter->getRType2(entry.Type));
+        Write8(TargetObjectWriter->getRType(entry.Type));
       }
       else {
         struct ELF::Elf64_Rela ERE64;
         ERE64.setSymbolAndType(entry.Index, entry.Type);
-        String64(*F, ERE64.r_info);
+        Write64(ERE64.r_info);
       }
       if (hasRelocationAddend())
-        String64(*F, entry.r_addend);
+        Write64(entry.r_addend);
     } else {
-      String32(*F, entry.r_offset);
+      Write32(entry.r_offset);
 
       struct ELF::Elf32_Rela ERE32;
       ERE32.setSymbolAndType(entry.Index, entry.Type);
-      String32(*F, ERE32.r_info);
+      Write32(ERE32.r_info);
 
       if (hasRelocationAddend())
-        String32(*F, entry.r_addend);
+        Write32(entry.r_addend);
     }
   }
+
+  std::vector<ELFRelocationEntry>().swap(Relocs);
 }
 
 static int compareBySuffix(const MCSectionELF *const *a,
@@ -1390,7 +1508,16 @@ bool ELFObjectWriter::IsELFMetaDataSection(const MCSectionData &SD) {
     !SD.getSection().isVirtualSection();
 }
 
-uint64_t ELFObjectWriter::DataSectionSize(const MCSectionData &SD) {
+uint64_t ELFObjectWriter::DataSectionSize(const MCSectionData &SD) const {
+  DenseMap<const MCSectionData*,
+           std::vector<ELFRelocationEntry> >::const_iterator R =
+    RelocationSectionEntries.find(&SD);
+  if (R != RelocationSectionEntries.end()) {
+    const MCSectionELF &Section =
+      static_cast<const MCSectionELF&>(SD.getSection());
+    return R->second.size() * Section.getEntrySize();
+  }
+
   uint64_t Ret = 0;
   for (MCSectionData::const_iterator i = SD.begin(), e = SD.end(); i != e;
        ++i) {
@@ -1402,16 +1529,24 @@ uint64_t ELFObjectWriter::DataSectionSize(const MCSectionData &SD) {
 }
 
 uint64_t ELFObjectWriter::GetSectionFileSize(const MCAsmLayout &Layout,
-                                             const MCSectionData &SD) {
+                                             const MCSectionData &SD) const {
   if (IsELFMetaDataSection(SD))
     return DataSectionSize(SD);
+  std::map<const MCSectionData*, SmallString<0> >::const_iterator I =
+    CompressedSections.find(&SD);
+  if (I != CompressedSections.end())
+    return I->second.size();
   return Layout.getSectionFileSize(&SD);
 }
 
 uint64_t ELFObjectWriter::GetSectionAddressSize(const MCAsmLayout &Layout,
-                                                const MCSectionData &SD) {
+                                                const MCSectionData &SD) const {
   if (IsELFMetaDataSection(SD))
     return DataSectionSize(SD);
+  std::map<const MCSectionData*, SmallString<0> >::const_iterator I =
+    CompressedSections.find(&SD);
+  if (I != CompressedSections.end())
+    return I->second.size();
   return Layout.getSectionAddressSize(&SD);
 }
 
@@ -1423,23 +1558,42 @@ void ELFObjectWriter::WriteDataSectionData(MCAssembler &Asm,
   uint64_t Padding = OffsetToAlignment(OS.tell(), SD.getAlignment());
   WriteZeros(Padding);
 
-  if (IsELFMetaDataSection(SD)) {
+  std::map<const MCSectionData*, SmallString<0> >::iterator I =
+    CompressedSections.find(&SD);
+  DenseMap<const MCSectionData*,
+           std::vector<ELFRelocationEntry> >::iterator R =
+    RelocationSectionEntries.find(&SD);
+
+  if (R != RelocationSectionEntries.end()) {
+    WriteRelocationEntries(Asm, R->second);
+  } else if (IsELFMetaDataSection(SD)) {
     for (MCSectionData::const_iterator i = SD.begin(), e = SD.end(); i != e;
          ++i) {
       const MCFragment &F = *i;
       assert(F.getKind() == MCFragment::FT_Data);
       WriteBytes(cast<MCDataFragment>(F).getContents());
     }
+  } else if (I != CompressedSections.end()) {
+    WriteBytes(I->second);
   } else {
     Asm.writeSectionData(&SD, Layout);
   }
+
+  // Nothing reads a section once its bytes are in the stream: the symbol table
+  // and group sections have already been built, the relocations only need
+  // their sorted entries, and the section headers use the sizes computed up
+  // front. Free the fragments now so that, for a large object, the memory of
+  // the sections written so far is available to the ones still to come.
+  if (I != CompressedSections.end())
+    CompressedSections.erase(I);
+  Asm.getOrCreateSectionData(Section).getFragmentList().clear();
 }
 
 void ELFObjectWriter::WriteSectionHeader(MCAssembler &Asm,
                                          const GroupMapTy &GroupMap,
-                                         const MCAsmLayout &Layout,
                                       const SectionIndexMapTy &SectionIndexMap,
-                                   const SectionOffsetMapTy &SectionOffsetMap) {
+                                    const SectionOffsetMapTy &SectionOffsetMap,
+                                        const SectionSizeMapTy &SectionSizeMap) {
   const unsigned NumSections = Asm.size() + 1;
 
   std::vector<const MCSectionELF*> Sections;
@@ -1468,10 +1622,9 @@ void ELFObjectWriter::WriteSectionHeader(MCAssembler &Asm,
       GroupSymbolIndex = getSymbolIndexInSymbolTable(Asm,
                                                      GroupMap.lookup(&Section));
 
-    uint64_t Size = GetSectionAddressSize(Layout, SD);
-
     WriteSection(Asm, SectionIndexMap, GroupSymbolIndex,
-                 SectionOffsetMap.lookup(&Section), Size,
+                 SectionOffsetMap.lookup(&Section),
+                 SectionSizeMap.lookup(&Section),
                  SD.getAlignment(), Section);
   }
 }
@@ -1514,6 +1667,10 @@ void ELFObjectWriter::WriteObject(MCAssembler &Asm,
 
   unsigned NumUserSections = Asm.size();
 
+  // Compress first: this renames sections, and both the relocation section
+  // names and the section string table are derived from the final names.
+  CompressDebugSections(Asm, const_cast<MCAsmLayout&>(Layout));
+
   DenseMap<const MCSectionELF*, const MCSectionELF*> RelMap;
   CreateRelocationSections(Asm, const_cast<MCAsmLayout&>(Layout), RelMap);
 
@@ -1529,7 +1686,7 @@ void ELFObjectWriter::WriteObject(MCAssembler &Asm,
   ComputeSymbolTable(Asm, SectionIndexMap, RevGroupMap, NumRegularSections);
 
 
-  WriteRelocations(Asm, const_cast<MCAsmLayout&>(Layout), RelMap);
+  SortRelocations(Asm, RelMap);
 
   CreateMetadataSections(const_cast<MCAssembler&>(Asm),
                          const_cast<MCAsmLayout&>(Layout),
@@ -1545,6 +1702,7 @@ void ELFObjectWriter::WriteObject(MCAssembler &Asm,
   ComputeSectionOrder(Asm, Sections);
   unsigned NumSections = Sections.size();
   SectionOffsetMapTy SectionOffsetMap;
+  SectionSizeMapTy SectionSizeMap;
   for (unsigned i = 0; i < NumRegularSections + 1; ++i) {
     const MCSectionELF &Section = *Sections[i];
     const MCSectionData &SD = Asm.getOrCreateSectionData(Section);
@@ -1553,6 +1711,7 @@ void ELFObjectWriter::WriteObject(MCAssembler &Asm,
 
     // Remember the offset into the file for this section.
     SectionOffsetMap[&Section] = FileOff;
+    SectionSizeMap[&Section] = GetSectionAddressSize(Layout, SD);
 
     // Get the size of the section in the output file (including padding).
     FileOff += GetSectionFileSize(Layout, SD);
@@ -1574,6 +1733,7 @@ void ELFObjectWriter::WriteObject(MCAssembler &Asm,
 
     // Remember the offset into the file for this section.
     SectionOffsetMap[&Section] = FileOff;
+    SectionSizeMap[&Section] = GetSectionAddressSize(Layout, SD);
 
     // Get the size of the section in the output file (including padding).
     FileOff += GetSectionFileSize(Layout, SD);
@@ -1591,8 +1751,8 @@ void ELFObjectWriter::WriteObject(MCAssembler &Asm,
   WriteZeros(Padding);
 
   // ... then the section header table ...
-  WriteSectionHeader(Asm, GroupMap, Layout, SectionIndexMap,
-                     SectionOffsetMap);
+  WriteSectionHeader(Asm, GroupMap, SectionIndexMap, SectionOffsetMap,
+                     SectionSizeMap);
 
   // ... and then the remaining sections ...
   for (unsigned i = NumRegularSections + 1; i < NumSections; ++i)
@@ -51,6 +51,7 @@ STATISTIC(FragmentLayouts, "Number of fragment layouts");
 STATISTIC(ObjectBytes, "Number of emitted object file bytes");
 STATISTIC(RelaxationSteps, "Number of assembler layout and relaxation steps");
 STATISTIC(RelaxedInstructions, "Number of relaxed instructions");
+STATISTIC(SectionLayouts, "Number of section layout and relaxation passes");
 }
 }
 
@@ -781,8 +782,7 @@ void MCAssembler::Finish() {
   }
 
   // Layout until everything fits.
-  while (layoutOnce(Layout))
-    continue;
+  layoutToFixedPoint(Layout);
 
   DEBUG_WITH_TYPE("mc-dump", {
       llvm::errs() << "assembler backend - post-relaxation\n--\n";
@@ -979,17 +979,36 @@ bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSectionData &SD) {
   return false;
 }
 
-bool MCAssembler::layoutOnce(MCAsmLayout &Layout) {
-  ++stats::RelaxationSteps;
+void MCAssembler::layoutToFixedPoint(MCAsmLayout &Layout) {
+  // Relaxing a section only moves fragments inside that section, and a
+  // section's relaxation decisions are a function of the current layout. So
+  // once every section has had a pass that changed nothing since the last
+  // change anywhere, the layout is stable. Cycle through the sections until
+  // that holds, rather than sweeping all of them again after every change;
+  // sections that settled after the last change are not revisited.
+  unsigned NumSections = size();
+  unsigned NumStable = 0;
+  iterator it = begin();
+  while (NumStable != NumSections) {
+    if (it == begin())
+      ++stats::RelaxationSteps;
 
-  bool WasRelaxed = false;
-  for (iterator it = begin(), ie = end(); it != ie; ++it) {
     MCSectionData &SD = *it;
-    while (layoutSectionOnce(Layout, SD))
-      WasRelaxed = true;
-  }
+    ++stats::SectionLayouts;
+    if (layoutSectionOnce(Layout, SD)) {
+      do
+        ++stats::SectionLayouts;
+      while (layoutSectionOnce(Layout, SD));
+      // This section's last pass was clean, but every other one must be
+      // rechecked against its new layout.
+      NumStable = 1;
+    } else {
+      ++NumStable;
+    }
 
-  return WasRelaxed;
+    if (++it == end())
+      it = begin();
+  }
 }
 
 void MCAssembler::finishLayout(MCAsmLayout &Layout) {
@@ -272,6 +272,21 @@ getELFSection(StringRef Section, unsigned Type, unsigned Flags,
   return Result;
 }
 
+void MCContext::renameELFSection(const MCSectionELF *Section, StringRef Name) {
+  StringRef GroupName;
+  if (const MCSymbol *Group = Section->getGroup())
+    GroupName = Group->getName();
+
+  ELFUniqueMapTy &Map = *(ELFUniqueMapTy*)ELFUniquingMap;
+  Map.erase(SectionGroupPair(Section->getSectionName(), GroupName));
+  ELFUniqueMapTy::iterator I =
+      Map.insert(std::make_pair(SectionGroupPair(Name, GroupName),
+                                Section)).first;
+
+  // The section keeps a reference to the name owned by the map.
+  const_cast<MCSectionELF*>(Section)->setSectionName(I->first.first);
+}
+
 const MCSectionELF *MCContext::CreateELFGroupSection() {
   MCSectionELF *Result =
     new (*this) MCSectionELF(".group", ELF::SHT_GROUP, 0,
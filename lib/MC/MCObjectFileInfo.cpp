@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/MC/MCObjectFileInfo.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/MC/MCContext.h"
 #include "llvm/MC/MCSection.h"
@@ -740,3 +741,10 @@ void MCObjectFileInfo::InitEHFrameSection() {
                           COFF::IMAGE_SCN_MEM_WRITE,
                           SectionKind::getDataRel());
 }
+
+const MCSection *MCObjectFileInfo::getDwarfTypesSection(uint64_t Hash) const {
+  if (Env != IsELF)
+    return 0;
+  return Ctx->getELFSection(".debug_types", ELF::SHT_PROGBITS, ELF::SHF_GROUP,
+                            SectionKind::getMetadata(), 0, utostr(Hash));
+}
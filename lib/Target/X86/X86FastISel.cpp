@@ -103,6 +103,8 @@ private:
 
   bool X86SelectBranch(const Instruction *I);
 
+  bool X86SelectSwitch(const Instruction *I);
+
   bool X86SelectShift(const Instruction *I);
 
   bool X86SelectDivRem(const Instruction *I);
@@ -1245,6 +1247,56 @@ bool X86FastISel::X86SelectBranch(const Instruction *I) {
   return true;
 }
 
+/// X86SelectSwitch - Lower a switch with a single case, which is what -O0
+/// code is left with for many two-way branches, to a compare and branch.
+/// Anything more needs compares in blocks of their own, which is left to
+/// SelectionDAG.
+bool X86FastISel::X86SelectSwitch(const Instruction *I) {
+  const SwitchInst *SI = cast<SwitchInst>(I);
+  MachineBasicBlock *DefaultMBB = FuncInfo.MBBMap[SI->getDefaultDest()];
+  if (SI->getNumCases() == 0) {
+    FastEmitBranch(DefaultMBB, DL);
+    return true;
+  }
+  if (SI->getNumCases() != 1)
+    return false;
+
+  MVT VT;
+  if (!isTypeLegal(SI->getCondition()->getType(), VT))
+    return false;
+
+  SwitchInst::ConstCaseIt Case = SI->case_begin();
+  const ConstantInt *CaseVal = Case.getCaseValue();
+  unsigned CmpOpc = X86ChooseCmpImmediateOpcode(VT, CaseVal);
+  if (CmpOpc == 0)
+    return false;
+
+  unsigned CondReg = getRegForValue(SI->getCondition());
+  if (CondReg == 0) return false;
+
+  MachineBasicBlock *CaseMBB = FuncInfo.MBBMap[Case.getCaseSuccessor()];
+  if (CaseMBB == DefaultMBB) {
+    FastEmitBranch(DefaultMBB, DL);
+    return true;
+  }
+
+  // Try to take advantage of fallthrough opportunities.
+  unsigned BranchOpc = X86::JE_4;
+  MachineBasicBlock *TrueMBB = CaseMBB, *FalseMBB = DefaultMBB;
+  if (FuncInfo.MBB->isLayoutSuccessor(TrueMBB)) {
+    std::swap(TrueMBB, FalseMBB);
+    BranchOpc = X86::JNE_4;
+  }
+
+  BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(CmpOpc))
+    .addReg(CondReg).addImm(CaseVal->getSExtValue());
+  BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(BranchOpc))
+    .addMBB(TrueMBB);
+  FastEmitBranch(FalseMBB, DL);
+  FuncInfo.MBB->addSuccessor(TrueMBB);
+  return true;
+}
+
 bool X86FastISel::X86SelectShift(const Instruction *I) {
   unsigned CReg = 0, OpReg = 0;
   const TargetRegisterClass *RC = NULL;
@@ -1674,6 +1726,21 @@ bool X86FastISel::X86VisitIntrinsicCall(const IntrinsicInst &I) {
 
     return DoSelectCall(&I, "memcpy");
   }
+  case Intrinsic::memmove: {
+    const MemMoveInst &MMI = cast<MemMoveInst>(I);
+    // Don't handle volatile memmoves.
+    if (MMI.isVolatile())
+      return false;
+
+    unsigned SizeWidth = Subtarget->is64Bit() ? 64 : 32;
+    if (!MMI.getLength()->getType()->isIntegerTy(SizeWidth))
+      return false;
+
+    if (MMI.getSourceAddressSpace() > 255 || MMI.getDestAddressSpace() > 255)
+      return false;
+
+    return DoSelectCall(&I, "memmove");
+  }
   case Intrinsic::memset: {
     const MemSetInst &MSI = cast<MemSetInst>(I);
 
@@ -1720,11 +1787,13 @@ bool X86FastISel::X86VisitIntrinsicCall(const IntrinsicInst &I) {
     return true;
   }
   case Intrinsic::sadd_with_overflow:
-  case Intrinsic::uadd_with_overflow: {
+  case Intrinsic::uadd_with_overflow:
+  case Intrinsic::ssub_with_overflow:
+  case Intrinsic::usub_with_overflow: {
     // FIXME: Should fold immediates.
 
-    // Replace "add with overflow" intrinsics with an "add" instruction followed
-    // by a seto/setc instruction.
+    // Replace "add/sub with overflow" intrinsics with an "add" or "sub"
+    // instruction followed by a seto/setc instruction.
     const Function *Callee = I.getCalledFunction();
     Type *RetTy =
       cast<StructType>(Callee->getReturnType())->getTypeAtIndex(unsigned(0));
@@ -1742,11 +1811,13 @@ bool X86FastISel::X86VisitIntrinsicCall(const IntrinsicInst &I) {
       // FIXME: Handle values *not* in registers.
       return false;
 
+    bool IsSub = I.getIntrinsicID() == Intrinsic::ssub_with_overflow ||
+                 I.getIntrinsicID() == Intrinsic::usub_with_overflow;
     unsigned OpC = 0;
     if (VT == MVT::i32)
-      OpC = X86::ADD32rr;
+      OpC = IsSub ? X86::SUB32rr : X86::ADD32rr;
     else if (VT == MVT::i64)
-      OpC = X86::ADD64rr;
+      OpC = IsSub ? X86::SUB64rr : X86::ADD64rr;
     else
       return false;
 
@@ -1757,7 +1828,8 @@ bool X86FastISel::X86VisitIntrinsicCall(const IntrinsicInst &I) {
       .addReg(Reg1).addReg(Reg2);
 
     unsigned Opc = X86::SETBr;
-    if (I.getIntrinsicID() == Intrinsic::sadd_with_overflow)
+    if (I.getIntrinsicID() == Intrinsic::sadd_with_overflow ||
+        I.getIntrinsicID() == Intrinsic::ssub_with_overflow)
       Opc = X86::SETOr;
     BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(Opc), ResultReg+1);
 
@@ -2323,6 +2395,8 @@ X86FastISel::TargetSelectInstruction(const Instruction *I)  {
     return X86SelectZExt(I);
   case Instruction::Br:
     return X86SelectBranch(I);
+  case Instruction::Switch:
+    return X86SelectSwitch(I);
   case Instruction::Call:
     return X86SelectCall(I);
   case Instruction::LShr:
@@ -22,6 +22,7 @@
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/CallSite.h"
 #include "llvm/Support/CommandLine.h"
@@ -50,9 +51,51 @@ static cl::opt<int>
 HintThreshold("inlinehint-threshold", cl::Hidden, cl::init(325),
               cl::desc("Threshold for inlining functions with inline hint"));
 
+static cl::opt<int>
+HotCallSiteThreshold("inline-hot-callsite-threshold", cl::Hidden,
+                     cl::init(325),
+                     cl::desc("Threshold for inlining call sites that the "
+                              "profile shows to be hot"));
+
+static cl::opt<int>
+ColdCallSiteThreshold("inline-cold-callsite-threshold", cl::Hidden,
+                      cl::init(0),
+                      cl::desc("Threshold for inlining call sites that the "
+                               "profile shows were never executed"));
+
+static cl::opt<unsigned>
+HotCallSiteCount("inline-hot-callsite-count", cl::Hidden, cl::init(1000),
+                 cl::desc("Minimum profile count for a call site to be "
+                          "considered hot"));
+
 // Threshold to use when optsize is specified (and there is no -inline-limit).
 const int OptSizeThreshold = 75;
 
+/// \brief Get the execution count recorded for a call site by a profile, if
+/// any.
+///
+/// Profile loaders record the weight of the block containing a call as a
+/// branch_weights node with a single weight. A weight of zero means the call
+/// site is known not to have executed; loaders leave calls they have too few
+/// samples for unannotated instead, since a sample count of zero does not by
+/// itself mean that.
+static bool getCallSiteProfileCount(CallSite CS, uint64_t &Count) {
+  MDNode *ProfileData =
+    CS.getInstruction()->getMetadata(LLVMContext::MD_prof);
+  if (!ProfileData || ProfileData->getNumOperands() != 2)
+    return false;
+
+  MDString *MDS = dyn_cast<MDString>(ProfileData->getOperand(0));
+  if (!MDS || !MDS->getString().equals("branch_weights"))
+    return false;
+
+  ConstantInt *Weight = dyn_cast<ConstantInt>(ProfileData->getOperand(1));
+  if (!Weight)
+    return false;
+  Count = Weight->getZExtValue();
+  return true;
+}
+
 Inliner::Inliner(char &ID) 
   : CallGraphSCCPass(ID), InlineThreshold(InlineLimit), InsertLifetime(true) {}
 
@@ -272,11 +315,22 @@ unsigned Inliner::getInlineThreshold(CallSite CS) const {
   bool InlineHint = Callee && !Callee->isDeclaration() &&
     Callee->getAttributes().hasAttribute(AttributeSet::FunctionIndex,
                                          Attribute::InlineHint);
-  if (InlineHint && HintThreshold > thres
-      && !Caller->getAttributes().hasAttribute(AttributeSet::FunctionIndex,
-                                               Attribute::MinSize))
+  bool MinSize = Caller->getAttributes().hasAttribute(
+      AttributeSet::FunctionIndex, Attribute::MinSize);
+  if (InlineHint && HintThreshold > thres && !MinSize)
     thres = HintThreshold;
 
+  // Listen to the profile, if there is one. Hot call sites get the higher of
+  // the two thresholds unless the caller must be small, and call sites that
+  // were never executed get the lower one.
+  uint64_t Count;
+  if (getCallSiteProfileCount(CS, Count)) {
+    if (Count >= HotCallSiteCount && HotCallSiteThreshold > thres && !MinSize)
+      thres = HotCallSiteThreshold;
+    else if (Count == 0 && ColdCallSiteThreshold < thres)
+      thres = ColdCallSiteThreshold;
+  }
+
   return thres;
 }
 
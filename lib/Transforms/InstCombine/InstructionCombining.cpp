@@ -65,12 +65,21 @@ STATISTIC(NumSunkInst , "Number of instructions sunk");
 STATISTIC(NumExpand,    "Number of expansions");
 STATISTIC(NumFactor   , "Number of factorizations");
 STATISTIC(NumReassoc  , "Number of reassociations");
+STATISTIC(NumIterations, "Number of iterations over a function");
+STATISTIC(NumVisited  , "Number of insts visited");
+STATISTIC(NumIterationLimit,
+          "Number of functions that hit the iteration limit");
 
 static cl::opt<bool> UnsafeFPShrink("enable-double-float-shrink", cl::Hidden,
                                    cl::init(false),
                                    cl::desc("Enable unsafe double to float "
                                             "shrinking for math lib calls"));
 
+static cl::opt<unsigned>
+MaxIterations("instcombine-max-iterations", cl::Hidden, cl::init(1000),
+              cl::desc("Maximum number of times instcombine iterates over "
+                       "a function (0 = unlimited)"));
+
 // Initialization Routines
 void llvm::initializeInstCombine(PassRegistry &Registry) {
   initializeInstCombinerPass(Registry);
@@ -2321,6 +2330,15 @@ bool InstCombiner::DoOneIteration(Function &F, unsigned Iteration) {
 
   DEBUG(dbgs() << "\n\nINSTCOMBINE ITERATION #" << Iteration << " on "
                << F.getName() << "\n");
+  ++NumIterations;
+
+#ifndef NDEBUG
+  // How often instructions of each opcode were visited and combined in this
+  // iteration.  Transforms that keep undoing each other show up here as the
+  // same opcodes being combined again on every iteration.
+  SmallVector<std::pair<unsigned, unsigned>, 64>
+    VisitCounts(Instruction::OtherOpsEnd);
+#endif
 
   {
     // Do a depth-first traversal of the function, populate the worklist with
@@ -2423,9 +2441,17 @@ bool InstCombiner::DoOneIteration(Function &F, unsigned Iteration) {
 #endif
     DEBUG(raw_string_ostream SS(OrigI); I->print(SS); OrigI = SS.str(););
     DEBUG(dbgs() << "IC: Visiting: " << OrigI << '\n');
+    ++NumVisited;
+#ifndef NDEBUG
+    std::pair<unsigned, unsigned> &Counts = VisitCounts[I->getOpcode()];
+    ++Counts.first;
+#endif
 
     if (Instruction *Result = visit(*I)) {
       ++NumCombined;
+#ifndef NDEBUG
+      ++Counts.second;
+#endif
       // Should we replace the old instruction with a new one?
       if (Result != I) {
         DEBUG(dbgs() << "IC: Old = " << *I << '\n'
@@ -2475,6 +2501,13 @@ bool InstCombiner::DoOneIteration(Function &F, unsigned Iteration) {
   }
 
   Worklist.Zap();
+
+  DEBUG(dbgs() << "IC: Iteration #" << Iteration << " combined (of visited):";
+        for (unsigned Op = 0, E = VisitCounts.size(); Op != E; ++Op)
+          if (VisitCounts[Op].second)
+            dbgs() << ' ' << Instruction::getOpcodeName(Op) << ' '
+                   << VisitCounts[Op].second << '/' << VisitCounts[Op].first;
+        dbgs() << '\n');
   return MadeIRChange;
 }
 
@@ -2520,10 +2553,18 @@ bool InstCombiner::runOnFunction(Function &F) {
   // by instcombiner.
   EverMadeChange = LowerDbgDeclare(F);
 
-  // Iterate while there is work to do.
+  // Iterate while there is work to do.  Every iteration rescans the whole
+  // function, so give up if transforms keep undoing each other.
   unsigned Iteration = 0;
-  while (DoOneIteration(F, Iteration++))
+  while (DoOneIteration(F, Iteration++)) {
     EverMadeChange = true;
+    if (MaxIterations && Iteration >= MaxIterations) {
+      DEBUG(dbgs() << "IC: Giving up on " << F.getName() << " after "
+                   << Iteration << " iterations\n");
+      ++NumIterationLimit;
+      break;
+    }
+  }
 
   Builder = 0;
   return EverMadeChange;
@@ -0,0 +1,626 @@
+//===- EdgeProfiling.cpp - Insert and read edge counters ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements instrumentation based profiling of control flow edges.
+// Two passes share the same view of each function's CFG:
+//
+// - The edge profiler (-insert-edge-profiling) computes a maximum spanning
+//   tree of the CFG, weighted by loop depth, and places a 64-bit counter on
+//   every edge that is not in the tree. Counters are registered with the
+//   profile runtime (compiler-rt's lib/profile), which appends them to
+//   $LLVM_EDGE_PROFILE_FILE, or default.edgeprof, when the program exits.
+//
+// - The edge profile loader (-edge-profile-loader) reads such a file, sums
+//   the records of all runs, recovers the count of every tree edge from flow
+//   conservation, and attaches branch_weights metadata to branches, switches
+//   and calls.
+//
+// Both passes must see the same IR, so the loader has to run at the point of
+// the pipeline where the instrumentation was inserted. Functions whose CFG
+// checksum does not match the profile are left alone.
+//
+// The profile is a text file with one record per function and run:
+//
+//    function_name checksum number_of_counters counter_1 ... counter_N
+//
+// Names of functions with local linkage are prefixed with the module
+// identifier and a colon. Profiles of several runs are merged by
+// concatenating the files.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "edge-profiling"
+
+#include "llvm/Transforms/Instrumentation.h"
+#include "MaximumSpanningTree.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CFG.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+#include <set>
+#include <vector>
+
+using namespace llvm;
+
+STATISTIC(NumEdgesInstrumented, "Number of edges instrumented");
+STATISTIC(NumFunctionsInstrumented, "Number of functions instrumented");
+STATISTIC(NumFunctionsAnnotated,
+          "Number of functions annotated from an edge profile");
+STATISTIC(NumFunctionsMismatched,
+          "Number of functions whose edge profile did not match");
+
+static cl::opt<std::string>
+EdgeProfileFile("edge-profile-file", cl::init("default.edgeprof"),
+                cl::value_desc("filename"), cl::Hidden,
+                cl::desc("Edge profile read by -edge-profile-loader"));
+
+namespace {
+
+/// \brief The edges of a function's CFG and where their counters go.
+///
+/// The CFG is extended with a virtual node, represented by null, that has an
+/// edge to the entry block and an edge from every block without successors.
+/// Parallel edges between the same two blocks are represented once.
+class EdgeProfileLayout {
+public:
+  typedef std::pair<const BasicBlock *, const BasicBlock *> Edge;
+
+  EdgeProfileLayout(const Function &F, const LoopInfo &LI);
+
+  /// \brief Whether every edge outside the spanning tree can be instrumented.
+  bool isValid() const { return Valid; }
+
+  unsigned getNumEdges() const { return Edges.size(); }
+  const Edge &getEdge(unsigned I) const { return Edges[I]; }
+
+  /// \brief Get the counter of an edge, or -1 for edges in the tree.
+  int getCounter(unsigned I) const { return Counters[I]; }
+  unsigned getNumCounters() const { return NumCounters; }
+
+  /// \brief A hash of the CFG, used to reject stale profiles.
+  uint32_t getChecksum() const { return Checksum; }
+
+private:
+  std::vector<Edge> Edges;
+  std::vector<int> Counters;
+  unsigned NumCounters;
+  uint32_t Checksum;
+  bool Valid;
+};
+
+} // end anonymous namespace
+
+/// \brief Test whether a counter on the edge would need a block of its own
+/// that cannot be created.
+static bool isUnsplittableEdge(const BasicBlock *From, const BasicBlock *To) {
+  if (!From || !To)
+    return false;
+  const TerminatorInst *TI = From->getTerminator();
+  if (TI->getNumSuccessors() == 1 || To->getUniquePredecessor())
+    return false;
+  return isa<IndirectBrInst>(TI) || To->isLandingPad();
+}
+
+static uint32_t hashValue(uint32_t Hash, uint32_t V) {
+  // FNV-1a, one byte at a time, so that the result does not depend on the
+  // host.
+  for (unsigned I = 0; I != 4; ++I) {
+    Hash ^= (V >> (I * 8)) & 0xff;
+    Hash *= 16777619u;
+  }
+  return Hash;
+}
+
+EdgeProfileLayout::EdgeProfileLayout(const Function &F, const LoopInfo &LI)
+    : NumCounters(0), Checksum(2166136261u), Valid(true) {
+  MaximumSpanningTree<BasicBlock>::EdgeWeights Weights;
+  DenseMap<const BasicBlock *, unsigned> BlockNumbers;
+
+  // Edges are weighted by the loop depth of their source, so that counters
+  // end up outside of loops where possible. Edges that cannot carry a
+  // counter are forced into the tree.
+  Edges.push_back(Edge((const BasicBlock *)0, &F.getEntryBlock()));
+  Weights.push_back(std::make_pair(Edges.back(), 1e20));
+  for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+    unsigned Number = BlockNumbers.size();
+    BlockNumbers[BB] = Number;
+    double Weight = 1 << std::min(2 * LI.getLoopDepth(BB), 30u);
+    const TerminatorInst *TI = BB->getTerminator();
+    if (TI->getNumSuccessors() == 0) {
+      Edges.push_back(Edge(BB, (const BasicBlock *)0));
+      Weights.push_back(std::make_pair(Edges.back(), Weight));
+      continue;
+    }
+    SmallPtrSet<const BasicBlock *, 8> Seen;
+    for (unsigned I = 0, NS = TI->getNumSuccessors(); I != NS; ++I) {
+      const BasicBlock *Succ = TI->getSuccessor(I);
+      if (!Seen.insert(Succ))
+        continue;
+      Edges.push_back(Edge(BB, Succ));
+      Weights.push_back(std::make_pair(
+          Edges.back(), isUnsplittableEdge(BB, Succ) ? 1e30 : Weight));
+    }
+  }
+
+  for (unsigned I = 0, E = Edges.size(); I != E; ++I) {
+    Checksum = hashValue(Checksum, Edges[I].first ?
+                                   BlockNumbers[Edges[I].first] + 1 : 0);
+    Checksum = hashValue(Checksum, Edges[I].second ?
+                                   BlockNumbers[Edges[I].second] + 1 : 0);
+  }
+
+  MaximumSpanningTree<BasicBlock> MST(Weights);
+  std::set<Edge> TreeEdges(MST.begin(), MST.end());
+  Counters.resize(Edges.size(), -1);
+  for (unsigned I = 0, E = Edges.size(); I != E; ++I) {
+    if (TreeEdges.count(Edges[I]))
+      continue;
+    if (isUnsplittableEdge(Edges[I].first, Edges[I].second))
+      Valid = false;
+    Counters[I] = NumCounters++;
+  }
+}
+
+/// \brief Get the name a function's counters are recorded under.
+static std::string getProfileName(const Function &F) {
+  if (!F.hasLocalLinkage())
+    return F.getName();
+  return (F.getParent()->getModuleIdentifier() + ":" + F.getName()).str();
+}
+
+//===----------------------------------------------------------------------===//
+// Edge profiler
+//===----------------------------------------------------------------------===//
+
+namespace {
+class EdgeProfiler : public ModulePass {
+public:
+  static char ID;
+  EdgeProfiler() : ModulePass(ID) {
+    initializeEdgeProfilerPass(*PassRegistry::getPassRegistry());
+  }
+
+  virtual const char *getPassName() const { return "Edge Profiler"; }
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<LoopInfo>();
+  }
+  virtual bool runOnModule(Module &M);
+
+private:
+  GlobalVariable *instrumentFunction(Function &F,
+                                     const EdgeProfileLayout &Layout);
+};
+}
+
+char EdgeProfiler::ID = 0;
+INITIALIZE_PASS_BEGIN(EdgeProfiler, "insert-edge-profiling",
+                      "Insert instrumentation for edge profiling", false, false)
+INITIALIZE_PASS_DEPENDENCY(LoopInfo)
+INITIALIZE_PASS_END(EdgeProfiler, "insert-edge-profiling",
+                    "Insert instrumentation for edge profiling", false, false)
+
+ModulePass *llvm::createEdgeProfilerPass() { return new EdgeProfiler(); }
+
+/// \brief Emit a counter increment before \p InsertPt.
+static void incrementCounter(GlobalVariable *Counters, unsigned Idx,
+                             Instruction *InsertPt) {
+  IRBuilder<> Builder(InsertPt);
+  Value *Addr = Builder.CreateConstInBoundsGEP2_64(Counters, 0, Idx);
+  Value *Count = Builder.CreateLoad(Addr);
+  Builder.CreateStore(Builder.CreateAdd(Count, Builder.getInt64(1)), Addr);
+}
+
+/// \brief Place the counters of \p Layout in \p F.
+///
+/// \returns the counter array.
+GlobalVariable *
+EdgeProfiler::instrumentFunction(Function &F, const EdgeProfileLayout &Layout) {
+  ArrayType *CounterTy =
+    ArrayType::get(Type::getInt64Ty(F.getContext()), Layout.getNumCounters());
+  GlobalVariable *Counters =
+    new GlobalVariable(*F.getParent(), CounterTy, false,
+                       GlobalValue::InternalLinkage,
+                       Constant::getNullValue(CounterTy),
+                       "__llvm_edge_profile_counters");
+
+  // Decide where every counter goes before changing the CFG.
+  SmallVector<std::pair<Instruction *, unsigned>, 16> InsertPts;
+  SmallVector<std::pair<BasicBlock *, unsigned>, 8> SplitEdges;
+  for (unsigned I = 0, E = Layout.getNumEdges(); I != E; ++I) {
+    int Counter = Layout.getCounter(I);
+    if (Counter < 0)
+      continue;
+    ++NumEdgesInstrumented;
+    BasicBlock *From = const_cast<BasicBlock *>(Layout.getEdge(I).first);
+    BasicBlock *To = const_cast<BasicBlock *>(Layout.getEdge(I).second);
+    if (!From)
+      InsertPts.push_back(std::make_pair(To->getFirstInsertionPt(), Counter));
+    else if (!To || From->getTerminator()->getNumSuccessors() == 1)
+      InsertPts.push_back(std::make_pair(From->getTerminator(), Counter));
+    else if (To->getUniquePredecessor())
+      // Parallel edges into a block that has no other predecessor are not
+      // critical; counting the block counts all of them.
+      InsertPts.push_back(std::make_pair(To->getFirstInsertionPt(), Counter));
+    else
+      SplitEdges.push_back(std::make_pair(From, I));
+  }
+
+  for (unsigned I = 0, E = InsertPts.size(); I != E; ++I)
+    incrementCounter(Counters, InsertPts[I].second, InsertPts[I].first);
+
+  // Critical edges get a block of their own. Parallel edges are merged into
+  // it, since they share a counter.
+  for (unsigned I = 0, E = SplitEdges.size(); I != E; ++I) {
+    unsigned EdgeIdx = SplitEdges[I].second;
+    unsigned Counter = Layout.getCounter(EdgeIdx);
+    const BasicBlock *To = Layout.getEdge(EdgeIdx).second;
+    TerminatorInst *TI = SplitEdges[I].first->getTerminator();
+    for (unsigned S = 0, NS = TI->getNumSuccessors(); S != NS; ++S) {
+      if (TI->getSuccessor(S) != To)
+        continue;
+      BasicBlock *NewBB = SplitCriticalEdge(TI, S, 0,
+                                            /*MergeIdenticalEdges=*/true);
+      assert(NewBB && "Edge should have been in the spanning tree");
+      if (NewBB)
+        incrementCounter(Counters, Counter, NewBB->getTerminator());
+      break;
+    }
+  }
+
+  return Counters;
+}
+
+bool EdgeProfiler::runOnModule(Module &M) {
+  LLVMContext &Ctx = M.getContext();
+  Type *Int32Ty = Type::getInt32Ty(Ctx);
+  Type *Int8PtrTy = Type::getInt8PtrTy(Ctx);
+  Type *Int64PtrTy = Type::getInt64PtrTy(Ctx);
+
+  // struct EdgeProfileFunction { const char *Name; uint32_t Checksum;
+  //                              uint32_t NumCounters; uint64_t *Counters; }
+  StructType *FunctionTy = StructType::get(Int8PtrTy, Int32Ty, Int32Ty,
+                                           Int64PtrTy, (Type *)0);
+
+  std::vector<Constant *> Records;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    if (F->isDeclaration())
+      continue;
+    EdgeProfileLayout Layout(*F, getAnalysis<LoopInfo>(*F));
+    if (!Layout.isValid() || Layout.getNumCounters() == 0)
+      continue;
+
+    GlobalVariable *Counters = instrumentFunction(*F, Layout);
+    ++NumFunctionsInstrumented;
+
+    Constant *Name = ConstantDataArray::getString(Ctx, getProfileName(*F));
+    GlobalVariable *NameVar =
+      new GlobalVariable(M, Name->getType(), true,
+                         GlobalValue::PrivateLinkage, Name,
+                         "__llvm_edge_profile_name");
+    Constant *Fields[] = {
+      ConstantExpr::getBitCast(NameVar, Int8PtrTy),
+      ConstantInt::get(Int32Ty, Layout.getChecksum()),
+      ConstantInt::get(Int32Ty, Layout.getNumCounters()),
+      ConstantExpr::getBitCast(Counters, Int64PtrTy)
+    };
+    Records.push_back(ConstantStruct::get(FunctionTy, Fields));
+  }
+  if (Records.empty())
+    return false;
+
+  // struct EdgeProfileModule { uint32_t NumFunctions;
+  //                            struct EdgeProfileFunction *Functions;
+  //                            struct EdgeProfileModule *Next; }
+  ArrayType *RecordsTy = ArrayType::get(FunctionTy, Records.size());
+  GlobalVariable *RecordsVar =
+    new GlobalVariable(M, RecordsTy, true, GlobalValue::InternalLinkage,
+                       ConstantArray::get(RecordsTy, Records),
+                       "__llvm_edge_profile_functions");
+  StructType *ModuleTy = StructType::get(Int32Ty,
+                                         PointerType::getUnqual(FunctionTy),
+                                         Int8PtrTy, (Type *)0);
+  Constant *ModuleInit[] = {
+    ConstantInt::get(Int32Ty, Records.size()),
+    ConstantExpr::getBitCast(RecordsVar, PointerType::getUnqual(FunctionTy)),
+    Constant::getNullValue(Int8PtrTy)
+  };
+  GlobalVariable *ModuleVar =
+    new GlobalVariable(M, ModuleTy, false, GlobalValue::InternalLinkage,
+                       ConstantStruct::get(ModuleTy, ModuleInit),
+                       "__llvm_edge_profile_module");
+
+  // Register the module with the runtime from a global constructor.
+  Type *VoidTy = Type::getVoidTy(Ctx);
+  Constant *RegisterFn =
+    M.getOrInsertFunction("llvm_edge_profile_register", VoidTy, Int8PtrTy,
+                          (Type *)0);
+  Function *Init =
+    Function::Create(FunctionType::get(VoidTy, false),
+                     GlobalValue::InternalLinkage,
+                     "__llvm_edge_profile_init", &M);
+  Init->setUnnamedAddr(true);
+  Init->addFnAttr(Attribute::NoInline);
+  IRBuilder<> Builder(BasicBlock::Create(Ctx, "entry", Init));
+  Builder.CreateCall(RegisterFn, ConstantExpr::getBitCast(ModuleVar,
+                                                          Int8PtrTy));
+  Builder.CreateRetVoid();
+  appendToGlobalCtors(M, Init, 0);
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+// Edge profile loader
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// \brief The merged counters of one function.
+struct EdgeProfileRecord {
+  uint32_t Checksum;
+  std::vector<uint64_t> Counts;
+};
+
+class EdgeProfileLoader : public ModulePass {
+public:
+  static char ID;
+  EdgeProfileLoader(StringRef Filename = "")
+      : ModulePass(ID), Filename(Filename.empty() ? EdgeProfileFile
+                                                  : Filename.str()) {
+    initializeEdgeProfileLoaderPass(*PassRegistry::getPassRegistry());
+  }
+
+  virtual const char *getPassName() const { return "Edge profile loader"; }
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<LoopInfo>();
+    AU.setPreservesCFG();
+  }
+  virtual bool runOnModule(Module &M);
+
+private:
+  void readProfile();
+  bool annotateFunction(Function &F, const EdgeProfileLayout &Layout,
+                        const EdgeProfileRecord &Record);
+
+  std::string Filename;
+  StringMap<EdgeProfileRecord> Records;
+};
+}
+
+char EdgeProfileLoader::ID = 0;
+INITIALIZE_PASS_BEGIN(EdgeProfileLoader, "edge-profile-loader",
+                      "Load edge profile information", false, false)
+INITIALIZE_PASS_DEPENDENCY(LoopInfo)
+INITIALIZE_PASS_END(EdgeProfileLoader, "edge-profile-loader",
+                    "Load edge profile information", false, false)
+
+ModulePass *llvm::createEdgeProfileLoaderPass(StringRef Filename) {
+  return new EdgeProfileLoader(Filename);
+}
+
+/// \brief Read the profile, summing the records of all runs.
+///
+/// Each record is a line of the form
+///
+///   name_length name checksum number_of_counters counter_1 ... counter_N
+///
+/// The name is length-prefixed since it may contain any character.
+void EdgeProfileLoader::readProfile() {
+  OwningPtr<MemoryBuffer> Buffer;
+  if (error_code EC = MemoryBuffer::getFile(Filename, Buffer))
+    report_fatal_error("Could not open edge profile " + Filename + ": " +
+                       EC.message());
+
+  StringRef Rest = Buffer->getBuffer();
+  for (unsigned RecordNo = 1;; ++RecordNo) {
+    Rest = Rest.ltrim();
+    if (Rest.empty())
+      break;
+
+    size_t NameStart = Rest.find(' ');
+    uint64_t NameLength;
+    if (NameStart == StringRef::npos ||
+        Rest.slice(0, NameStart).getAsInteger(10, NameLength) ||
+        NameLength > Rest.size() - NameStart - 1)
+      report_fatal_error(Filename + ": malformed edge profile record " +
+                         Twine(RecordNo));
+    StringRef Name = Rest.substr(NameStart + 1, NameLength);
+    std::pair<StringRef, StringRef> LineAndRest =
+      Rest.substr(NameStart + 1 + NameLength).split('\n');
+    Rest = LineAndRest.second;
+
+    SmallVector<StringRef, 16> Fields;
+    LineAndRest.first.split(Fields, " ", -1, false);
+    uint32_t Checksum, NumCounters;
+    if (Fields.size() < 2 || Fields[0].getAsInteger(10, Checksum) ||
+        Fields[1].getAsInteger(10, NumCounters) ||
+        Fields.size() != 2 + NumCounters)
+      report_fatal_error(Filename + ": malformed edge profile record " +
+                         Twine(RecordNo));
+
+    StringMapEntry<EdgeProfileRecord> &Entry = Records.GetOrCreateValue(Name);
+    EdgeProfileRecord &Record = Entry.getValue();
+    if (Record.Counts.empty()) {
+      Record.Checksum = Checksum;
+      Record.Counts.resize(NumCounters);
+    } else if (Record.Checksum != Checksum ||
+               Record.Counts.size() != NumCounters) {
+      // A run of a different build of the function. Keep the first one.
+      continue;
+    }
+    for (unsigned I = 0; I != NumCounters; ++I) {
+      uint64_t Count;
+      if (Fields[2 + I].getAsInteger(10, Count))
+        report_fatal_error(Filename + ": malformed counter in edge profile "
+                           "record " + Twine(RecordNo));
+      Record.Counts[I] += Count;
+    }
+  }
+}
+
+/// \brief Scale \p Count down by \p Scale and fit it into a branch weight.
+static uint32_t getWeight(uint64_t Count, uint64_t Scale) {
+  return (uint32_t)std::min<uint64_t>(Count / Scale, UINT32_MAX);
+}
+
+/// \brief Recover the count of every edge of \p F from the counters in
+/// \p Record and attach them as branch weights.
+bool EdgeProfileLoader::annotateFunction(Function &F,
+                                         const EdgeProfileLayout &Layout,
+                                         const EdgeProfileRecord &Record) {
+  unsigned NumEdges = Layout.getNumEdges();
+  std::vector<int64_t> Counts(NumEdges, 0);
+  std::vector<bool> Known(NumEdges, false);
+
+  // Edges incident to each node. The virtual node is null.
+  DenseMap<const BasicBlock *, SmallVector<unsigned, 4> > Incident;
+  for (unsigned I = 0; I != NumEdges; ++I) {
+    const EdgeProfileLayout::Edge &E = Layout.getEdge(I);
+    Incident[E.first].push_back(I);
+    Incident[E.second].push_back(I);
+    if (Layout.getCounter(I) >= 0) {
+      Counts[I] = Record.Counts[Layout.getCounter(I)];
+      Known[I] = true;
+    }
+  }
+
+  // The tree edges are solved leaf first: a node with a single unknown edge
+  // has as much flow going in as coming out.
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (DenseMap<const BasicBlock *, SmallVector<unsigned, 4> >::iterator
+           NI = Incident.begin(), NE = Incident.end(); NI != NE; ++NI) {
+      const BasicBlock *Node = NI->first;
+      int Unknown = -1;
+      unsigned NumUnknown = 0;
+      int64_t InFlow = 0, OutFlow = 0;
+      for (unsigned J = 0, JE = NI->second.size(); J != JE; ++J) {
+        unsigned EI = NI->second[J];
+        const EdgeProfileLayout::Edge &E = Layout.getEdge(EI);
+        // A self loop adds as much in as it takes out.
+        if (E.first == E.second) {
+          if (!Known[EI])
+            ++NumUnknown, Unknown = EI;
+          continue;
+        }
+        if (!Known[EI]) {
+          ++NumUnknown;
+          Unknown = EI;
+        } else if (E.second == Node) {
+          InFlow += Counts[EI];
+        } else {
+          OutFlow += Counts[EI];
+        }
+      }
+      if (NumUnknown != 1)
+        continue;
+      const EdgeProfileLayout::Edge &E = Layout.getEdge(Unknown);
+      int64_t Count = E.second == Node ? OutFlow - InFlow : InFlow - OutFlow;
+      Counts[Unknown] = std::max<int64_t>(Count, 0);
+      Known[Unknown] = true;
+      Changed = true;
+    }
+  }
+
+  MDBuilder MDB(F.getContext());
+  DenseMap<std::pair<const BasicBlock *, const BasicBlock *>, uint64_t>
+    EdgeCounts;
+  for (unsigned I = 0; I != NumEdges; ++I)
+    EdgeCounts[Layout.getEdge(I)] = Counts[I];
+
+  for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+    TerminatorInst *TI = BB->getTerminator();
+    // Parallel edges share one count, so only sum over distinct successors.
+    uint64_t BlockCount = 0;
+    SmallPtrSet<const BasicBlock *, 8> Succs;
+    for (unsigned S = 0, NS = TI->getNumSuccessors(); S != NS; ++S)
+      if (Succs.insert(TI->getSuccessor(S)))
+        BlockCount +=
+          EdgeCounts.lookup(std::make_pair(BB, TI->getSuccessor(S)));
+    if (TI->getNumSuccessors() == 0)
+      BlockCount = EdgeCounts.lookup(
+          std::make_pair((const BasicBlock *)BB, (const BasicBlock *)0));
+
+    // Parallel edges share a count, which goes to the first of them.
+    if (TI->getNumSuccessors() > 1 &&
+        (isa<BranchInst>(TI) || isa<SwitchInst>(TI))) {
+      SmallVector<uint64_t, 4> EdgeWeights;
+      SmallPtrSet<const BasicBlock *, 8> Seen;
+      uint64_t MaxCount = 0;
+      for (unsigned S = 0, NS = TI->getNumSuccessors(); S != NS; ++S) {
+        const BasicBlock *Succ = TI->getSuccessor(S);
+        uint64_t Count = Seen.insert(Succ) ?
+          EdgeCounts.lookup(std::make_pair(BB, Succ)) : 0;
+        EdgeWeights.push_back(Count);
+        MaxCount = std::max(MaxCount, Count);
+      }
+      uint64_t Scale = MaxCount / UINT32_MAX + 1;
+      SmallVector<uint32_t, 4> Weights;
+      for (unsigned S = 0, NS = EdgeWeights.size(); S != NS; ++S)
+        Weights.push_back(getWeight(EdgeWeights[S], Scale));
+      TI->setMetadata(LLVMContext::MD_prof, MDB.createBranchWeights(Weights));
+    }
+
+    // Calls get the count of their block, like the sample profile loader
+    // does, so that the inliner can see how hot they are.
+    MDNode *CallWeight = 0;
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+      CallInst *CI = dyn_cast<CallInst>(I);
+      if (!CI || isa<IntrinsicInst>(CI))
+        continue;
+      if (!CallWeight)
+        CallWeight = MDB.createBranchWeights(getWeight(BlockCount, 1));
+      CI->setMetadata(LLVMContext::MD_prof, CallWeight);
+    }
+  }
+  return true;
+}
+
+bool EdgeProfileLoader::runOnModule(Module &M) {
+  readProfile();
+
+  bool Changed = false;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    if (F->isDeclaration())
+      continue;
+    StringMap<EdgeProfileRecord>::const_iterator RI =
+      Records.find(getProfileName(*F));
+    if (RI == Records.end())
+      continue;
+
+    EdgeProfileLayout Layout(*F, getAnalysis<LoopInfo>(*F));
+    const EdgeProfileRecord &Record = RI->getValue();
+    if (!Layout.isValid() || Layout.getChecksum() != Record.Checksum ||
+        Layout.getNumCounters() != Record.Counts.size()) {
+      DEBUG(dbgs() << "Edge profile for " << F->getName()
+                   << " does not match its CFG\n");
+      ++NumFunctionsMismatched;
+      continue;
+    }
+    Changed |= annotateFunction(*F, Layout, Record);
+    ++NumFunctionsAnnotated;
+  }
+  return Changed;
+}
@@ -20,6 +20,11 @@
 //      that edge. The weight of a block B is computed as the maximum
 //      number of samples found in B.
 //
+// Profiles can be read from a text file, or from a native (binary) file with
+// an index sorted by function name. Native files are memory mapped and only
+// the profiles of functions in the module are ever decoded. A text profile
+// can be converted with -sample-profile-native-output.
+//
 //===----------------------------------------------------------------------===//
 
 #define DEBUG_TYPE "sample-profile"
@@ -32,6 +37,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/MDBuilder.h"
@@ -39,6 +45,8 @@
 #include "llvm/Pass.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/InstIterator.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Regex.h"
@@ -53,6 +61,20 @@ static cl::opt<std::string> SampleProfileFile(
     "sample-profile-file", cl::init(""), cl::value_desc("filename"),
     cl::desc("Profile file loaded by -sample-profile"), cl::Hidden);
 
+// Command line option to write the loaded profile back out in the native
+// format. This is how text profiles are converted.
+static cl::opt<std::string> SampleProfileNativeOutput(
+    "sample-profile-native-output", cl::init(""), cl::value_desc("filename"),
+    cl::desc("Write the profile loaded by -sample-profile to this file in "
+             "the native format"), cl::Hidden);
+
+// Command line option to specify how many samples a function needs before
+// blocks without samples in it are taken to have never executed.
+static cl::opt<unsigned> SampleProfileColdMinSamples(
+    "sample-profile-cold-min-samples", cl::init(1000),
+    cl::desc("Minimum number of samples in a function for calls in blocks "
+             "without samples to be marked as never executed"), cl::Hidden);
+
 namespace {
 /// \brief Sample-based profile reader.
 ///
@@ -79,11 +101,14 @@ namespace {
 ///      be relative to the start of the function.
 class SampleProfile {
 public:
-  SampleProfile(StringRef F) : Profiles(0), Filename(F) {}
+  SampleProfile(StringRef F)
+      : Profiles(0), Filename(F), NativeIndex(0), NumNativeFunctions(0) {}
 
   void dump();
+  void load();
   void loadText();
-  void loadNative() { llvm_unreachable("not implemented"); }
+  void loadNative(MemoryBuffer *Buffer);
+  void writeNative(StringRef OutFilename);
   bool emitAnnotations(Function &F);
   void printFunctionProfile(raw_ostream &OS, StringRef FName);
   void dumpFunctionProfile(StringRef FName);
@@ -119,8 +144,16 @@ protected:
     /// The weight of a basic block is defined to be the maximum
     /// of all the instruction weights in that block.
     BlockWeightMap BlockWeights;
+
+    /// \brief Whether this profile has been decoded from the native file.
+    bool Loaded;
   };
 
+  FunctionProfile &getFunctionProfile(StringRef FName);
+  bool findNativeProfile(StringRef FName, uint64_t &Offset);
+  void readNativeProfile(uint64_t Offset, FunctionProfile &FProfile);
+  void reportNativeError(const Twine &Msg) const;
+
   uint32_t getInstWeight(Instruction &I, unsigned FirstLineno,
                          BodySampleMap &BodySamples);
   uint32_t computeBlockWeight(BasicBlock *B, unsigned FirstLineno,
@@ -140,6 +173,15 @@ protected:
   /// version of the profile format to be used in constructing test
   /// cases and debugging.
   StringRef Filename;
+
+  /// \brief The mapped native profile file, if that is what was loaded.
+  OwningPtr<MemoryBuffer> NativeBuffer;
+
+  /// \brief Start of the function index in NativeBuffer.
+  const char *NativeIndex;
+
+  /// \brief Number of entries in the native function index.
+  uint64_t NumNativeFunctions;
 };
 
 /// \brief Loader class for text-based profiles.
@@ -354,6 +396,206 @@ void SampleProfile::loadText() {
   }
 }
 
+/// Layout of native profile files. All integers are little endian.
+///
+///   Header:  magic (8 bytes), version (uint32), padding (uint32),
+///            number of functions (uint64)
+///   Index:   one entry per function, sorted by name:
+///            name offset (uint64), name size (uint64),
+///            profile offset (uint64)
+///   Names:   the function names, not null terminated
+///   Bodies:  one record per function:
+///            total samples (uint32), total head samples (uint32),
+///            number of lines (uint32), then that many pairs of
+///            line offset (uint32) and number of samples (uint32)
+///
+/// All offsets are from the start of the file.
+static const char NativeMagic[8] = { '\xff', 'l', 'l', 'v', 'm', 's', 'p',
+                                     'f' };
+static const uint32_t NativeVersion = 1;
+static const uint64_t NativeHeaderSize = 24;
+static const uint64_t NativeIndexEntrySize = 24;
+
+static uint32_t readLE32(const char *P) {
+  return support::endian::read<uint32_t, support::little, support::unaligned>(
+      P);
+}
+
+static uint64_t readLE64(const char *P) {
+  return support::endian::read<uint64_t, support::little, support::unaligned>(
+      P);
+}
+
+static void writeLE32(raw_ostream &OS, uint32_t V) {
+  char Buf[4];
+  support::endian::write<uint32_t, support::little, support::unaligned>(Buf,
+                                                                          V);
+  OS.write(Buf, sizeof(Buf));
+}
+
+static void writeLE64(raw_ostream &OS, uint64_t V) {
+  char Buf[8];
+  support::endian::write<uint64_t, support::little, support::unaligned>(Buf,
+                                                                          V);
+  OS.write(Buf, sizeof(Buf));
+}
+
+/// \brief Load the profile, detecting its format from the file contents.
+void SampleProfile::load() {
+  OwningPtr<MemoryBuffer> Buffer;
+  if (error_code EC = MemoryBuffer::getFile(Filename, Buffer))
+    report_fatal_error("Could not open profile file " + Filename + ": " +
+                       EC.message());
+  if (Buffer->getBufferSize() >= sizeof(NativeMagic) &&
+      memcmp(Buffer->getBufferStart(), NativeMagic, sizeof(NativeMagic)) == 0)
+    loadNative(Buffer.take());
+  else
+    loadText();
+}
+
+void SampleProfile::reportNativeError(const Twine &Msg) const {
+  report_fatal_error(Filename + ": malformed native profile: " + Msg);
+}
+
+/// \brief Load a native profile from \p Buffer, taking ownership of it.
+///
+/// Only the header is validated here. Function profiles are decoded on
+/// demand by getFunctionProfile, so the cost of loading is proportional to
+/// the number of functions in the module rather than the size of the file.
+void SampleProfile::loadNative(MemoryBuffer *Buffer) {
+  NativeBuffer.reset(Buffer);
+  const char *Start = Buffer->getBufferStart();
+  uint64_t Size = Buffer->getBufferSize();
+  if (Size < NativeHeaderSize)
+    reportNativeError("truncated header");
+  if (readLE32(Start + 8) != NativeVersion)
+    reportNativeError("unsupported version");
+  NumNativeFunctions = readLE64(Start + 16);
+  if (NumNativeFunctions > (Size - NativeHeaderSize) / NativeIndexEntrySize)
+    reportNativeError("truncated index");
+  NativeIndex = Start + NativeHeaderSize;
+}
+
+/// \brief Binary search the native index for \p FName.
+///
+/// \returns true and sets \p Offset to the offset of the function's profile
+/// if it is in the index.
+bool SampleProfile::findNativeProfile(StringRef FName, uint64_t &Offset) {
+  const char *Start = NativeBuffer->getBufferStart();
+  uint64_t Size = NativeBuffer->getBufferSize();
+  uint64_t Lo = 0, Hi = NumNativeFunctions;
+  while (Lo < Hi) {
+    uint64_t Mid = Lo + (Hi - Lo) / 2;
+    const char *Entry = NativeIndex + Mid * NativeIndexEntrySize;
+    uint64_t NameOffset = readLE64(Entry);
+    uint64_t NameSize = readLE64(Entry + 8);
+    if (NameOffset > Size || NameSize > Size - NameOffset)
+      reportNativeError("function name out of bounds");
+    int Cmp = StringRef(Start + NameOffset, NameSize).compare(FName);
+    if (Cmp == 0) {
+      Offset = readLE64(Entry + 16);
+      return true;
+    }
+    if (Cmp < 0)
+      Lo = Mid + 1;
+    else
+      Hi = Mid;
+  }
+  return false;
+}
+
+/// \brief Decode the native profile record at \p Offset into \p FProfile.
+void SampleProfile::readNativeProfile(uint64_t Offset,
+                                      FunctionProfile &FProfile) {
+  const char *Start = NativeBuffer->getBufferStart();
+  uint64_t Size = NativeBuffer->getBufferSize();
+  if (Offset > Size || Size - Offset < 12)
+    reportNativeError("function profile out of bounds");
+  const char *P = Start + Offset;
+  FProfile.TotalSamples = readLE32(P);
+  FProfile.TotalHeadSamples = readLE32(P + 4);
+  uint32_t NumLines = readLE32(P + 8);
+  P += 12;
+  if ((uint64_t)NumLines > (uint64_t)(Start + Size - P) / 8)
+    reportNativeError("function profile out of bounds");
+  for (uint32_t I = 0; I < NumLines; ++I, P += 8)
+    FProfile.BodySamples[readLE32(P)] += readLE32(P + 4);
+}
+
+/// \brief Return the profile for \p FName, decoding it from the native
+/// profile the first time it is requested.
+SampleProfile::FunctionProfile &
+SampleProfile::getFunctionProfile(StringRef FName) {
+  FunctionProfile &FProfile = Profiles[FName];
+  if (!NativeBuffer || FProfile.Loaded)
+    return FProfile;
+  FProfile.Loaded = true;
+  uint64_t Offset;
+  if (findNativeProfile(FName, Offset))
+    readNativeProfile(Offset, FProfile);
+  return FProfile;
+}
+
+/// \brief Write every function profile to \p OutFilename in the native
+/// format.
+void SampleProfile::writeNative(StringRef OutFilename) {
+  // A native profile is only partially decoded, pull everything in first.
+  if (NativeBuffer)
+    for (uint64_t I = 0; I != NumNativeFunctions; ++I) {
+      const char *Entry = NativeIndex + I * NativeIndexEntrySize;
+      uint64_t NameOffset = readLE64(Entry);
+      uint64_t NameSize = readLE64(Entry + 8);
+      if (NameOffset > NativeBuffer->getBufferSize() ||
+          NameSize > NativeBuffer->getBufferSize() - NameOffset)
+        reportNativeError("function name out of bounds");
+      getFunctionProfile(
+          StringRef(NativeBuffer->getBufferStart() + NameOffset, NameSize));
+    }
+
+  std::vector<StringRef> Names;
+  for (StringMap<FunctionProfile>::const_iterator I = Profiles.begin(),
+                                                  E = Profiles.end();
+       I != E; ++I)
+    Names.push_back(I->getKey());
+  std::sort(Names.begin(), Names.end());
+
+  std::string ErrorInfo;
+  raw_fd_ostream OS(OutFilename.str().c_str(), ErrorInfo, sys::fs::F_Binary);
+  if (!ErrorInfo.empty())
+    report_fatal_error("Could not open " + OutFilename + ": " + ErrorInfo);
+
+  OS.write(NativeMagic, sizeof(NativeMagic));
+  writeLE32(OS, NativeVersion);
+  writeLE32(OS, 0);
+  writeLE64(OS, Names.size());
+
+  uint64_t NameOffset = NativeHeaderSize + Names.size() * NativeIndexEntrySize;
+  uint64_t ProfileOffset = NameOffset;
+  for (unsigned I = 0, E = Names.size(); I != E; ++I)
+    ProfileOffset += Names[I].size();
+  for (unsigned I = 0, E = Names.size(); I != E; ++I) {
+    writeLE64(OS, NameOffset);
+    writeLE64(OS, Names[I].size());
+    writeLE64(OS, ProfileOffset);
+    NameOffset += Names[I].size();
+    ProfileOffset += 12 + 8 * Profiles[Names[I]].BodySamples.size();
+  }
+  for (unsigned I = 0, E = Names.size(); I != E; ++I)
+    OS << Names[I];
+  for (unsigned I = 0, E = Names.size(); I != E; ++I) {
+    FunctionProfile &FProfile = Profiles[Names[I]];
+    writeLE32(OS, FProfile.TotalSamples);
+    writeLE32(OS, FProfile.TotalHeadSamples);
+    writeLE32(OS, FProfile.BodySamples.size());
+    for (BodySampleMap::const_iterator SI = FProfile.BodySamples.begin(),
+                                       SE = FProfile.BodySamples.end();
+         SI != SE; ++SI) {
+      writeLE32(OS, SI->first);
+      writeLE32(OS, SI->second);
+    }
+  }
+}
+
 /// \brief Get the weight for an instruction.
 ///
 /// The "weight" of an instruction \p Inst is the number of samples
@@ -422,7 +664,7 @@ uint32_t SampleProfile::computeBlockWeight(BasicBlock *B, unsigned FirstLineno,
 /// \param F The function to query.
 bool SampleProfile::emitAnnotations(Function &F) {
   bool Changed = false;
-  FunctionProfile &FProfile = Profiles[F.getName()];
+  FunctionProfile &FProfile = getFunctionProfile(F.getName());
   unsigned FirstLineno = inst_begin(F)->getDebugLoc().getLine();
   MDBuilder MDB(F.getContext());
 
@@ -453,6 +695,34 @@ bool SampleProfile::emitAnnotations(Function &F) {
     Changed = true;
   }
 
+  // Record the weight of the enclosing block on every call, so that the
+  // inliner can tell hot call sites from cold ones. Functions without samples
+  // are left alone, they were not necessarily cold. Neither are blocks
+  // without samples in a function with few samples: a weight of zero is only
+  // recorded once the function has been sampled often enough for it to mean
+  // that the block never executed.
+  if (FProfile.TotalSamples == 0)
+    return Changed;
+  bool RecordZeroWeights = FProfile.TotalSamples >= SampleProfileColdMinSamples;
+  for (Function::iterator I = F.begin(), E = F.end(); I != E; ++I) {
+    BasicBlock *B = I;
+    MDNode *Weight = 0;
+    for (BasicBlock::iterator BI = B->begin(), BE = B->end(); BI != BE; ++BI) {
+      CallInst *CI = dyn_cast<CallInst>(BI);
+      if (!CI || isa<IntrinsicInst>(CI))
+        continue;
+      if (!Weight) {
+        uint32_t BlockWeight =
+            computeBlockWeight(B, FirstLineno, FProfile.BodySamples);
+        if (BlockWeight == 0 && !RecordZeroWeights)
+          break;
+        Weight = MDB.createBranchWeights(BlockWeight);
+      }
+      CI->setMetadata(llvm::LLVMContext::MD_prof, Weight);
+      Changed = true;
+    }
+  }
+
   return Changed;
 }
 
@@ -466,7 +736,9 @@ bool SampleProfileLoader::runOnFunction(Function &F) {
 
 bool SampleProfileLoader::doInitialization(Module &M) {
   Profiler.reset(new SampleProfile(Filename));
-  Profiler->loadText();
+  Profiler->load();
+  if (!SampleProfileNativeOutput.empty())
+    Profiler->writeNative(SampleProfileNativeOutput);
   return true;
 }
 
@@ -0,0 +1,95 @@
+/*===- EdgeProfiling.c - Support library for edge profiling ---------------===*\
+|*
+|*                     The LLVM Compiler Infrastructure
+|*
+|* This file is distributed under the University of Illinois Open Source
+|* License. See LICENSE.TXT for details.
+|*
+|*===----------------------------------------------------------------------===*|
+|*
+|* This file implements the call back routines for the edge profiling
+|* instrumentation pass. Link against this library when running code through
+|* the -insert-edge-profiling LLVM pass.
+|*
+|* Every instrumented module registers its counters from a global constructor.
+|* When the program exits, one line per function is appended to the file named
+|* by $LLVM_EDGE_PROFILE_FILE, or default.edgeprof:
+|*
+|*    name_length name checksum number_of_counters counter_1 ... counter_N
+|*
+|* The name is length-prefixed since it may contain spaces or newlines.
+|* Appending keeps the counts of earlier runs, which the -edge-profile-loader
+|* pass sums up.
+|*
+\*===----------------------------------------------------------------------===*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _MSC_VER
+#include <stdint.h>
+#else
+typedef unsigned int uint32_t;
+typedef unsigned long long uint64_t;
+#endif
+
+/*
+ * The layout of these structures must match the ones emitted by
+ * lib/Transforms/Instrumentation/EdgeProfiling.cpp.
+ */
+struct edge_profile_function {
+  const char *name;
+  uint32_t checksum;
+  uint32_t num_counters;
+  uint64_t *counters;
+};
+
+struct edge_profile_module {
+  uint32_t num_functions;
+  struct edge_profile_function *functions;
+  struct edge_profile_module *next;
+};
+
+/*
+ * The registered modules, most recently registered first.
+ */
+static struct edge_profile_module *modules = NULL;
+
+static void llvm_edge_profile_write_file(void) {
+  const char *filename = getenv("LLVM_EDGE_PROFILE_FILE");
+  struct edge_profile_module *module;
+  FILE *output_file;
+
+  if (!filename || !*filename)
+    filename = "default.edgeprof";
+
+  output_file = fopen(filename, "a");
+  if (!output_file) {
+    fprintf(stderr, "profiling: %s: cannot open edge profile\n", filename);
+    return;
+  }
+
+  for (module = modules; module; module = module->next) {
+    uint32_t i, j;
+    for (i = 0; i < module->num_functions; ++i) {
+      const struct edge_profile_function *fn = &module->functions[i];
+      fprintf(output_file, "%lu %s %u %u", (unsigned long)strlen(fn->name),
+              fn->name, (unsigned)fn->checksum, (unsigned)fn->num_counters);
+      for (j = 0; j < fn->num_counters; ++j)
+        fprintf(output_file, " %llu", (unsigned long long)fn->counters[j]);
+      fputc('\n', output_file);
+    }
+  }
+
+  fclose(output_file);
+}
+
+void llvm_edge_profile_register(void *module_ptr) {
+  struct edge_profile_module *module =
+    (struct edge_profile_module *)module_ptr;
+  if (!modules)
+    atexit(llvm_edge_profile_write_file);
+  module->next = modules;
+  modules = module;
+}
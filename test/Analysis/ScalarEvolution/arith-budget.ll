@@ -0,0 +1,18 @@
+; RUN: opt -analyze -scalar-evolution < %s | FileCheck %s
+; RUN: opt -analyze -scalar-evolution -scalar-evolution-max-arith-depth=0 < %s | FileCheck %s -check-prefix=DEPTH
+; RUN: opt -analyze -scalar-evolution -scalar-evolution-max-arith-operands=1 < %s | FileCheck %s -check-prefix=OPS
+
+; Once the budget is exhausted, add expressions are uniqued without having
+; repeated operands merged.
+
+define i32 @test(i32 %a, i32 %b) {
+  %x = add i32 %a, %b
+  %y = add i32 %x, %a
+; CHECK: %y = add i32 %x, %a
+; CHECK-NEXT: -->  ((2 * %a) + %b)
+; DEPTH: %y = add i32 %x, %a
+; DEPTH-NEXT: -->  (%a + %a + %b)
+; OPS: %y = add i32 %x, %a
+; OPS-NEXT: -->  (%a + %a + %b)
+  ret i32 %y
+}
@@ -0,0 +1,28 @@
+; RUN: llc < %s -O0 -fast-isel-report -mtriple=x86_64-unknown-linux-gnu -o /dev/null 2>&1 | FileCheck %s
+
+; The report lists what FastISel missed, starting with what cost the most
+; instructions going through SelectionDAG.
+
+; CHECK: FastISel miss report
+; CHECK: Misses  Insts to DAG  Instruction
+; CHECK-NEXT: 1             3  switch
+; CHECK-NEXT: 1             1  call llvm.ctpop
+
+define i32 @f(i32 %x, i32 %y) {
+entry:
+  %a = add i32 %x, %y
+  %b = mul i32 %a, %y
+  switch i32 %b, label %def [
+    i32 1, label %one
+    i32 2, label %two
+  ]
+one:
+  %c = call i32 @llvm.ctpop.i32(i32 %x)
+  ret i32 %c
+two:
+  ret i32 2
+def:
+  ret i32 0
+}
+
+declare i32 @llvm.ctpop.i32(i32)
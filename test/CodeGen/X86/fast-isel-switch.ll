@@ -0,0 +1,48 @@
+; RUN: llc < %s -O0 -fast-isel-abort -verify-machineinstrs -mtriple=x86_64-unknown-linux-gnu | FileCheck %s
+
+; A switch with a single case is a compare and a branch.
+define i32 @one_case(i32 %x) {
+; CHECK-LABEL: one_case:
+; CHECK: cmpl $7, %edi
+; CHECK-NEXT: jne
+entry:
+  switch i32 %x, label %def [
+    i32 7, label %a
+  ]
+a:
+  ret i32 10
+def:
+  ret i32 0
+}
+
+define i32 @no_case(i32 %x) {
+; CHECK-LABEL: no_case:
+; CHECK-NOT: cmp
+; CHECK: ret
+entry:
+  switch i32 %x, label %def [
+  ]
+def:
+  ret i32 0
+}
+
+define i32 @sub_overflow(i32 %x, i32 %y) {
+; CHECK-LABEL: sub_overflow:
+; CHECK: subl %esi, %edi
+; CHECK-NEXT: seto
+  %r = call { i32, i1 } @llvm.ssub.with.overflow.i32(i32 %x, i32 %y)
+  %v = extractvalue { i32, i1 } %r, 0
+  %o = extractvalue { i32, i1 } %r, 1
+  %s = select i1 %o, i32 0, i32 %v
+  ret i32 %s
+}
+
+define void @move(i8* %d, i8* %s, i64 %n) {
+; CHECK-LABEL: move:
+; CHECK: callq memmove
+  call void @llvm.memmove.p0i8.p0i8.i64(i8* %d, i8* %s, i64 %n, i32 1, i1 false)
+  ret void
+}
+
+declare { i32, i1 } @llvm.ssub.with.overflow.i32(i32, i32)
+declare void @llvm.memmove.p0i8.p0i8.i64(i8*, i8*, i64, i32, i1)
@@ -0,0 +1,100 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -verify-machineinstrs | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -verify-machineinstrs \
+; RUN:   -greedy-split-budget=1 -greedy-eviction-budget=1 | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -verify-machineinstrs \
+; RUN:   -greedy-split-budget=0 -greedy-eviction-budget=2 | FileCheck %s
+;
+; A state machine keeping more values live around its dispatch loop than there
+; are registers. When the split and eviction budgets run out, the greedy
+; allocator must still produce valid code by spilling the remaining live
+; ranges.
+
+; CHECK-LABEL: state_machine:
+; CHECK: Spill
+; CHECK: Reload
+; CHECK: ret
+
+define i32 @state_machine(i32* %in, i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  %state = phi i32 [ 0, %entry ], [ %next, %latch ]
+  %v0 = phi i32 [ 1, %entry ], [ %v0.next, %latch ]
+  %v1 = phi i32 [ 2, %entry ], [ %v1.next, %latch ]
+  %v2 = phi i32 [ 3, %entry ], [ %v2.next, %latch ]
+  %v3 = phi i32 [ 4, %entry ], [ %v3.next, %latch ]
+  %v4 = phi i32 [ 5, %entry ], [ %v4.next, %latch ]
+  %v5 = phi i32 [ 6, %entry ], [ %v5.next, %latch ]
+  %v6 = phi i32 [ 7, %entry ], [ %v6.next, %latch ]
+  %v7 = phi i32 [ 8, %entry ], [ %v7.next, %latch ]
+  %v8 = phi i32 [ 9, %entry ], [ %v8.next, %latch ]
+  %v9 = phi i32 [ 10, %entry ], [ %v9.next, %latch ]
+  %v10 = phi i32 [ 11, %entry ], [ %v10.next, %latch ]
+  %v11 = phi i32 [ 12, %entry ], [ %v11.next, %latch ]
+  switch i32 %state, label %latch [
+    i32 0, label %s0
+    i32 1, label %s1
+  ]
+
+s0:
+  %p0 = getelementptr i32* %in, i32 %i
+  %x0 = load i32* %p0
+  %s0v0 = add i32 %v0, %x0
+  %s0v2 = mul i32 %v2, %x0
+  %s0v3 = sub i32 %v3, %x0
+  %s0v4 = add i32 %v4, %x0
+  %s0v6 = mul i32 %v6, %x0
+  %s0v8 = add i32 %v8, %x0
+  %s0v9 = xor i32 %v9, %x0
+  %s0v10 = mul i32 %v10, %x0
+  %t0 = and i32 %x0, 1
+  br label %latch
+
+s1:
+  %p1 = getelementptr i32* %in, i32 %i
+  %x1 = load i32* %p1
+  %s1v1 = mul i32 %v1, %x1
+  %s1v2 = sub i32 %v2, %x1
+  %s1v3 = add i32 %v3, %x1
+  %s1v5 = mul i32 %v5, %x1
+  %s1v7 = add i32 %v7, %x1
+  %s1v8 = xor i32 %v8, %x1
+  %s1v9 = mul i32 %v9, %x1
+  %s1v11 = add i32 %v11, %x1
+  %t1 = and i32 %x1, 1
+  br label %latch
+
+latch:
+  %next = phi i32 [ 0, %loop ], [ %t0, %s0 ], [ %t1, %s1 ]
+  %v0.next = phi i32 [ %v0, %loop ], [ %s0v0, %s0 ], [ %v0, %s1 ]
+  %v1.next = phi i32 [ %v1, %loop ], [ %v1, %s0 ], [ %s1v1, %s1 ]
+  %v2.next = phi i32 [ %v2, %loop ], [ %s0v2, %s0 ], [ %s1v2, %s1 ]
+  %v3.next = phi i32 [ %v3, %loop ], [ %s0v3, %s0 ], [ %s1v3, %s1 ]
+  %v4.next = phi i32 [ %v4, %loop ], [ %s0v4, %s0 ], [ %v4, %s1 ]
+  %v5.next = phi i32 [ %v5, %loop ], [ %v5, %s0 ], [ %s1v5, %s1 ]
+  %v6.next = phi i32 [ %v6, %loop ], [ %s0v6, %s0 ], [ %v6, %s1 ]
+  %v7.next = phi i32 [ %v7, %loop ], [ %v7, %s0 ], [ %s1v7, %s1 ]
+  %v8.next = phi i32 [ %v8, %loop ], [ %s0v8, %s0 ], [ %s1v8, %s1 ]
+  %v9.next = phi i32 [ %v9, %loop ], [ %s0v9, %s0 ], [ %s1v9, %s1 ]
+  %v10.next = phi i32 [ %v10, %loop ], [ %s0v10, %s0 ], [ %v10, %s1 ]
+  %v11.next = phi i32 [ %v11, %loop ], [ %v11, %s0 ], [ %s1v11, %s1 ]
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  %r1 = add i32 %v0.next, %v1.next
+  %r2 = add i32 %r1, %v2.next
+  %r3 = add i32 %r2, %v3.next
+  %r4 = add i32 %r3, %v4.next
+  %r5 = add i32 %r4, %v5.next
+  %r6 = add i32 %r5, %v6.next
+  %r7 = add i32 %r6, %v7.next
+  %r8 = add i32 %r7, %v8.next
+  %r9 = add i32 %r8, %v9.next
+  %r10 = add i32 %r9, %v10.next
+  %r11 = add i32 %r10, %v11.next
+  ret i32 %r11
+}
@@ -0,0 +1,24 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -time-passes -o /dev/null 2>&1 | FileCheck %s
+
+; The per-phase DAG timers should cover building the DAG as well as the
+; phases that run on it.
+; CHECK: Instruction Selection and Scheduling
+; CHECK-DAG: DAG Building
+; CHECK-DAG: DAG Combining 1
+; CHECK-DAG: DAG Legalization
+; CHECK-DAG: Instruction Selection
+; CHECK-DAG: Instruction Scheduling
+
+define i32 @f(i32 %a, i32 %b) {
+entry:
+  %c = icmp slt i32 %a, %b
+  br i1 %c, label %then, label %else
+
+then:
+  %x = add i32 %a, %b
+  ret i32 %x
+
+else:
+  %y = mul i32 %a, %b
+  ret i32 %y
+}
@@ -0,0 +1,27 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -disable-trivial-block-isel \
+; RUN:   | FileCheck %s
+
+; %other only falls through to %join and feeds its PHI %b, which is already in
+; a virtual register, so it is selected without building a DAG for it. The
+; code must be the same as what the DAG path produces.
+
+; CHECK-LABEL: pick:
+; CHECK: testb $1, %dil
+; CHECK-NEXT: je .LBB0_2
+; CHECK-NEXT: # BB#1: # %other
+; CHECK-NEXT: movl %edx, %esi
+; CHECK-NEXT: .LBB0_2: # %join
+; CHECK-NEXT: movl %esi, %eax
+; CHECK-NEXT: ret
+define i32 @pick(i1 %c, i32 %a, i32 %b) {
+entry:
+  br i1 %c, label %other, label %join
+
+other:
+  br label %join
+
+join:
+  %r = phi i32 [ %a, %entry ], [ %b, %other ]
+  ret i32 %r
+}
@@ -0,0 +1,29 @@
+// Code of the first unit is placed on both sides of the second unit, so it is
+// described with DW_AT_ranges. .debug_aranges is removed afterwards, so the
+// address ranges have to be built from the compile unit DIEs.
+//   g++ -gdwarf-2 -O0 -c llvm-symbolizer-ranges.cc -o ranges.o
+//   g++ -gdwarf-2 -O0 -c -DSECOND_UNIT llvm-symbolizer-ranges.cc -o second.o
+//   g++ -nostdlib -Wl,-e,main -Wl,-z,noseparate-code -Wl,--build-id=none \
+//     ranges.o second.o -o llvm-symbolizer-ranges.elf-x86-64
+//   objcopy --remove-section=.debug_aranges llvm-symbolizer-ranges.elf-x86-64
+// The assembler emits version 3 line tables, which are laid out like version 2
+// ones. Their version field is then rewritten to 2, the only version the line
+// table parser reads.
+
+#ifndef SECOND_UNIT
+__attribute__((section(".text.unlikely")))
+int cold_function(int x) {
+  return x * 3;
+}
+
+int second_function(int x);
+
+int main() {
+  return cold_function(1) + second_function(2);
+}
+#else
+__attribute__((section(".text.startup")))
+int second_function(int x) {
+  return x + 5;
+}
+#endif
@@ -0,0 +1,19 @@
+// Ten compile units, each describing its code with DW_AT_low_pc and
+// DW_AT_high_pc. .debug_aranges is removed afterwards, so the address ranges
+// have to be built from the compile unit DIEs.
+//   for i in 0 1 2 3 4 5 6 7 8 9; do
+//     g++ -gdwarf-2 -O0 -c -DUNIT=$i llvm-symbolizer-units.cc -o unit$i.o
+//   done
+//   g++ -nostdlib -Wl,-e,unit0 -Wl,-z,noseparate-code -Wl,--build-id=none \
+//     unit*.o -o llvm-symbolizer-units.elf-x86-64
+//   objcopy --remove-section=.debug_aranges llvm-symbolizer-units.elf-x86-64
+// The assembler emits version 3 line tables, which are laid out like version 2
+// ones. Their version field is then rewritten to 2, the only version the line
+// table parser reads.
+
+#define CONCAT2(A, B) A##B
+#define CONCAT(A, B) CONCAT2(A, B)
+
+extern "C" int CONCAT(unit, UNIT)(int x) {
+  return x + UNIT;
+}
@@ -0,0 +1,33 @@
+// RUN: llvm-mc -filetype=obj -compress-debug-sections -triple x86_64-pc-linux-gnu %s -o %t
+// RUN: FileCheck %s -check-prefix=COMPRESSED < %t
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu %s -o %t.plain
+// RUN: FileCheck %s -check-prefix=PLAIN < %t.plain
+// REQUIRES: zlib
+
+// Compressible debug sections are renamed to .zdebug_* and get a "ZLIB"
+// header; sections that would not shrink and non-debug sections are left
+// alone.  Relocation sections follow the renamed section.
+
+// COMPRESSED: ZLIB
+// COMPRESSED-DAG: .zdebug_str
+// COMPRESSED-DAG: .rela.zdebug_info
+// COMPRESSED-DAG: .debug_abbrev
+// COMPRESSED-DAG: .text
+
+// PLAIN-NOT: zdebug
+// PLAIN-NOT: ZLIB
+
+	.text
+foo:
+	ret
+
+	.section	.debug_str,"MS",@progbits,1
+	.fill	256, 1, 0x61
+	.byte	0
+
+	.section	.debug_info,"",@progbits
+	.quad	foo
+	.fill	512, 1, 0
+
+	.section	.debug_abbrev,"",@progbits
+	.byte	0
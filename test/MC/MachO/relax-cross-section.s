@@ -0,0 +1,19 @@
+// RUN: llvm-mc -triple x86_64-apple-darwin10 %s -filetype=obj -o - | macho-dump --dump-section-data | FileCheck %s
+
+// The ULEB in __text is laid out before the jump in the later __more section
+// is relaxed. Once the jump grows from 2 to 5 bytes, __text has to be
+// revisited: the distance goes from 126 to 129 and no longer fits in one byte.
+
+        .text
+        .uleb128 Lend - Lstart
+
+        .section __TEXT,__more,regular,pure_instructions
+Lstart:
+        jmp Lfar
+        .space 124, 0x90
+Lend:
+        .space 10, 0x90
+Lfar:
+
+// CHECK: ('_section_data', '8101')
+// CHECK: ('_section_data', 'e9860000 00909090
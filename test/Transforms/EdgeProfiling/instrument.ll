@@ -0,0 +1,79 @@
+; RUN: opt < %s -insert-edge-profiling -S | FileCheck %s
+
+; Counters go on the edges outside of a spanning tree of the CFG. Critical
+; edges are split to make room for them.
+
+; CHECK: @__llvm_edge_profile_counters = internal global [3 x i64] zeroinitializer
+; CHECK: @__llvm_edge_profile_name = private constant [5 x i8] c"loop\00"
+; CHECK: @__llvm_edge_profile_counters1 = internal global [2 x i64] zeroinitializer
+; CHECK: @__llvm_edge_profile_name2 = private constant [9 x i8] c"parallel\00"
+; CHECK: @__llvm_edge_profile_functions = internal constant [2 x { i8*, i32, i32, i64* }]
+; CHECK: @__llvm_edge_profile_module = internal global { i32, { i8*, i32, i32, i64* }*, i8* } { i32 2,
+; CHECK: @llvm.global_ctors = appending global {{.*}} @__llvm_edge_profile_init
+
+define i32 @loop(i32 %n) {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  br i1 %cmp, label %body, label %exit
+
+body:
+  %i = phi i32 [ 0, %entry ], [ %inc, %body ]
+  %inc = add i32 %i, 1
+  %done = icmp eq i32 %inc, %n
+  br i1 %done, label %exit, label %body
+
+exit:
+  %r = phi i32 [ 0, %entry ], [ %inc, %body ]
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @loop
+; CHECK: br i1 %cmp, label %body, label %entry.exit_crit_edge
+; CHECK: entry.exit_crit_edge:
+; CHECK: add i64 {{.*}}, 1
+; CHECK: br i1 %done, label %exit, label %body.body_crit_edge
+; CHECK: body.body_crit_edge:
+; CHECK: add i64 {{.*}}, 1
+; CHECK: exit:
+; CHECK: add i64 {{.*}}, 1
+; CHECK-NEXT: store i64
+; CHECK-NEXT: ret i32 %r
+
+; Parallel edges into a block that has no other predecessor are not
+; critical, the counter goes into that block.
+define i32 @parallel(i32 %c) {
+entry:
+  switch i32 %c, label %y [
+    i32 0, label %x
+    i32 1, label %x
+    i32 2, label %y
+  ]
+
+x:
+  ret i32 1
+
+y:
+  ret i32 2
+}
+
+; CHECK-LABEL: define i32 @parallel
+; CHECK: entry:
+; CHECK-NEXT: switch i32 %c, label %y [
+; CHECK-NEXT: i32 0, label %x
+; CHECK-NEXT: i32 1, label %x
+; CHECK-NEXT: i32 2, label %y
+; CHECK-NEXT: ]
+; CHECK: x:
+; CHECK: add i64 {{.*}}, 1
+; CHECK-NEXT: store i64
+; CHECK-NEXT: ret i32 1
+; CHECK: y:
+; CHECK: add i64 {{.*}}, 1
+; CHECK-NEXT: store i64
+; CHECK-NEXT: ret i32 2
+
+; Declarations are not instrumented.
+declare void @external()
+
+; CHECK-LABEL: define internal void @__llvm_edge_profile_init()
+; CHECK: call void @llvm_edge_profile_register(i8* bitcast
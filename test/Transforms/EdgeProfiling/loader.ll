@@ -0,0 +1,62 @@
+; RUN: opt < %s -edge-profile-loader -edge-profile-file=%S/Inputs/loader.edgeprof -S | FileCheck %s
+
+; The records of both runs are summed up. The counts of the edges that were
+; not instrumented follow from flow conservation.
+
+define i32 @loop(i32 %n) {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  br i1 %cmp, label %body, label %exit
+; CHECK: br i1 %cmp, label %body, label %exit, !prof ![[ENTRY:[0-9]+]]
+
+body:
+  %i = phi i32 [ 0, %entry ], [ %inc, %body ]
+  call void @external()
+; CHECK: call void @external(), !prof ![[CALL:[0-9]+]]
+  %inc = add i32 %i, 1
+  %done = icmp eq i32 %inc, %n
+  br i1 %done, label %exit, label %body
+; CHECK: br i1 %done, label %exit, label %body, !prof ![[BODY:[0-9]+]]
+
+exit:
+  %r = phi i32 [ 0, %entry ], [ %inc, %body ]
+  ret i32 %r
+}
+
+; A profile with a different checksum is ignored.
+define i32 @stale(i1 %c) {
+entry:
+  br i1 %c, label %a, label %b
+; CHECK: br i1 %c, label %a, label %b{{$}}
+a:
+  ret i32 0
+b:
+  ret i32 1
+}
+
+; A name may contain spaces. Parallel edges are counted once: the block ran
+; three times, twice through the edges to %x.
+define i32 @"dup succ"(i32 %c) {
+entry:
+  call void @external()
+; CHECK: call void @external(), !prof ![[DUPCALL:[0-9]+]]
+  switch i32 %c, label %y [
+    i32 0, label %x
+    i32 1, label %x
+  ]
+; CHECK: ], !prof ![[DUPSWITCH:[0-9]+]]
+
+x:
+  ret i32 1
+
+y:
+  ret i32 2
+}
+
+declare void @external()
+
+; CHECK-DAG: ![[ENTRY]] = metadata !{metadata !"branch_weights", i32 9, i32 1}
+; CHECK-DAG: ![[CALL]] = metadata !{metadata !"branch_weights", i32 99}
+; CHECK-DAG: ![[BODY]] = metadata !{metadata !"branch_weights", i32 9, i32 90}
+; CHECK-DAG: ![[DUPCALL]] = metadata !{metadata !"branch_weights", i32 3}
+; CHECK-DAG: ![[DUPSWITCH]] = metadata !{metadata !"branch_weights", i32 1, i32 2, i32 0}
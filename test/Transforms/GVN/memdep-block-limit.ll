@@ -0,0 +1,27 @@
+; RUN: opt -basicaa -gvn -S < %s | FileCheck %s
+; RUN: opt -basicaa -gvn -memdep-block-number-limit=2 -S < %s | FileCheck %s -check-prefix=LIMIT
+
+; The load in %merge is fully redundant with the store in %entry, but finding
+; that requires a non-local query that visits three blocks.
+
+define i32 @test(i32* %p, i1 %c) {
+; CHECK: @test
+; CHECK-NOT: load
+; CHECK: ret i32 42
+; LIMIT: @test
+; LIMIT: %v = load i32* %p
+; LIMIT: ret i32 %v
+entry:
+  store i32 42, i32* %p
+  br i1 %c, label %a, label %b
+
+a:
+  br label %merge
+
+b:
+  br label %merge
+
+merge:
+  %v = load i32* %p
+  ret i32 %v
+}
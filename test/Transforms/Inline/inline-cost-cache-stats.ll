@@ -0,0 +1,29 @@
+; REQUIRES: asserts
+; RUN: opt -S -inline -inline-threshold=0 -stats < %s 2>&1 | FileCheck %s
+
+; Both calls of @g look the same to the cost analysis, so the callee body is
+; only analyzed once.
+
+; CHECK: 1 inline-cost - Number of call site costs found in the cache
+; CHECK: 1 inline-cost - Number of call sites analyzed
+
+define i32 @g(i32 %x) {
+entry:
+  %a = mul i32 %x, %x
+  %b = add i32 %a, %x
+  %c = mul i32 %b, %a
+  %d = add i32 %c, %b
+  ret i32 %d
+}
+
+define i32 @caller1(i32 %x) {
+entry:
+  %r = call i32 @g(i32 %x)
+  ret i32 %r
+}
+
+define i32 @caller2(i32 %y) {
+entry:
+  %r = call i32 @g(i32 %y)
+  ret i32 %r
+}
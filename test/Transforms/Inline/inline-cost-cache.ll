@@ -0,0 +1,44 @@
+; RUN: opt -S -inline -inline-threshold=10 < %s | FileCheck %s
+
+; Call sites that look the same to the cost analysis get the same inlining
+; decision, and that decision is based on the callee as it is when the call
+; sites are visited: @h is inlined into @g first, which makes @g cheap enough
+; to inline into both callers. A cost computed for the original @g would have
+; kept the calls.
+
+define internal i32 @h(i32 %x) {
+entry:
+  %a = mul i32 %x, %x
+  %b = add i32 %a, %x
+  %c = mul i32 %b, %a
+  %d = add i32 %c, %b
+  ret i32 %d
+}
+
+; CHECK-LABEL: define i32 @g(
+; CHECK-NOT: call
+; CHECK: ret i32
+define i32 @g(i32 %x) {
+entry:
+  %r = call i32 @h(i32 0)
+  %s = add i32 %r, %x
+  ret i32 %s
+}
+
+; CHECK-LABEL: define i32 @caller1(
+; CHECK-NOT: call
+; CHECK: ret i32
+define i32 @caller1(i32 %x) {
+entry:
+  %r = call i32 @g(i32 %x)
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @caller2(
+; CHECK-NOT: call
+; CHECK: ret i32
+define i32 @caller2(i32 %y) {
+entry:
+  %r = call i32 @g(i32 %y)
+  ret i32 %r
+}
@@ -0,0 +1,46 @@
+; RUN: opt < %s -inline -inline-threshold=0 -S | FileCheck %s -check-prefix=HOT
+; RUN: opt < %s -inline -S | FileCheck %s -check-prefix=COLD
+
+; Call sites carrying a profile count use the hot or cold call site threshold
+; instead of the regular one.
+
+define i32 @callee(i32 %x) {
+entry:
+  %a = mul i32 %x, %x
+  %b = add i32 %a, %x
+  %c = mul i32 %b, %a
+  %d = add i32 %c, %b
+  ret i32 %d
+}
+
+define i32 @plain(i32 %x) {
+; HOT-LABEL: @plain(
+; HOT: call i32 @callee
+; COLD-LABEL: @plain(
+; COLD-NOT: call i32 @callee
+entry:
+  %r = call i32 @callee(i32 %x)
+  ret i32 %r
+}
+
+define i32 @hot(i32 %x) {
+; HOT-LABEL: @hot(
+; HOT-NOT: call i32 @callee
+; COLD-LABEL: @hot(
+; COLD-NOT: call i32 @callee
+entry:
+  %r = call i32 @callee(i32 %x), !prof !0
+  ret i32 %r
+}
+
+define i32 @cold(i32 %x) {
+; HOT-LABEL: @cold(
+; COLD-LABEL: @cold(
+; COLD: call i32 @callee
+entry:
+  %r = call i32 @callee(i32 %x), !prof !1
+  ret i32 %r
+}
+
+!0 = metadata !{metadata !"branch_weights", i32 5000}
+!1 = metadata !{metadata !"branch_weights", i32 0}
@@ -0,0 +1,19 @@
+; RUN: opt < %s -instcombine -stats -S 2>&1 | FileCheck %s
+; RUN: opt < %s -instcombine -instcombine-max-iterations=1 -stats -S 2>&1 | FileCheck %s -check-prefix=LIMIT
+; REQUIRES: asserts
+
+; Once something has changed, instcombine takes another look at the whole
+; function, unless it has already used up its iterations.
+
+define i32 @test(i32 %a) {
+  %x = add i32 %a, 0
+  ret i32 %x
+}
+
+; CHECK: ret i32 %a
+; CHECK: 2 instcombine - Number of iterations over a function
+; CHECK-NOT: iteration limit
+
+; LIMIT: ret i32 %a
+; LIMIT: 1 instcombine - Number of iterations over a function
+; LIMIT: 1 instcombine - Number of functions that hit the iteration limit
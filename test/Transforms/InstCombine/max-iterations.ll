@@ -0,0 +1,30 @@
+; RUN: opt < %s -instcombine -S | FileCheck %s
+; RUN: opt < %s -instcombine -instcombine-max-iterations=1 -S | FileCheck %s -check-prefix=LIMIT
+
+; The first iteration folds the branch condition. Only the second one sees
+; that %f is unreachable and deletes its instructions, so a limit of one
+; iteration leaves them alone.
+
+define i32 @test(i32 %a) {
+entry:
+  %c = icmp eq i32 %a, %a
+  br i1 %c, label %t, label %f
+
+t:
+  ret i32 0
+
+f:
+  %y = mul i32 %a, %a
+  ret i32 %y
+}
+
+; CHECK-LABEL: @test(
+; CHECK: br i1 true, label %t, label %f
+; CHECK: f:
+; CHECK-NEXT: ret i32 undef
+
+; LIMIT-LABEL: @test(
+; LIMIT: br i1 true, label %t, label %f
+; LIMIT: f:
+; LIMIT-NEXT: %y = mul i32 %a, %a
+; LIMIT-NEXT: ret i32 %y
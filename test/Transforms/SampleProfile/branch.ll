@@ -1,4 +1,23 @@
 ; RUN: opt < %s -sample-profile -sample-profile-file=%S/Inputs/branch.prof | opt -analyze -branch-prob | FileCheck %s
+; RUN: opt < %s -sample-profile -sample-profile-file=%S/Inputs/branch.prof -S | FileCheck %s -check-prefix=CALL
+; RUN: opt < %s -sample-profile -sample-profile-file=%S/Inputs/branch.prof \
+; RUN:   -sample-profile-cold-min-samples=100000 -S | FileCheck %s -check-prefix=FEW
+
+; Converting the profile to the native format must not change the result.
+; RUN: opt < %s -sample-profile -sample-profile-file=%S/Inputs/branch.prof -sample-profile-native-output=%t.prof -disable-output
+; RUN: opt < %s -sample-profile -sample-profile-file=%t.prof | opt -analyze -branch-prob | FileCheck %s
+
+; Calls are annotated with the weight of their block, intrinsics are not.
+; CALL: call i32 @atoi({{.*}}, !prof ![[ATOI:[0-9]+]]
+; CALL-NOT: call void @llvm.dbg.value({{.*}}!prof
+; CALL: call i32 (i8*, ...)* @printf({{.*}}, !prof ![[PRINTF:[0-9]+]]
+; CALL-DAG: ![[ATOI]] = metadata !{metadata !"branch_weights", i32 {{[0-9]+}}}
+; CALL-DAG: ![[PRINTF]] = metadata !{metadata !"branch_weights", i32 {{[0-9]+}}}
+
+; Blocks without samples are only taken to be cold in functions with enough
+; samples. Otherwise their calls are left without a count.
+; FEW: call i32 @atoi({{.*}}, !dbg !{{[0-9]+}}{{$}}
+; FEW: call i32 (i8*, ...)* @printf({{.*}}, !dbg !{{[0-9]+}}{{$}}
 
 ; Original C++ code for this test case:
 ;
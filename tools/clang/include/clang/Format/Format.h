@@ -40,6 +40,14 @@ struct FormatStyle {
   /// \brief The maximum number of consecutive empty lines to keep.
   unsigned MaxEmptyLinesToKeep;
 
+  /// \brief The number of states the line-breaking search may create for a
+  /// single line before it falls back to completing the line greedily.
+  unsigned MaxAnalyzedStates;
+
+  /// \brief The number of states the greedy fallback tries to complete before
+  /// it gives up and leaves the line as it is.
+  unsigned MaxGreedyAttempts;
+
   /// \brief The penalty for each line break introduced inside a comment.
   unsigned PenaltyBreakComment;
 
@@ -279,6 +287,8 @@ struct FormatStyle {
                R.IndentFunctionDeclarationAfterType &&
            IndentWidth == R.IndentWidth &&
            MaxEmptyLinesToKeep == R.MaxEmptyLinesToKeep &&
+           MaxAnalyzedStates == R.MaxAnalyzedStates &&
+           MaxGreedyAttempts == R.MaxGreedyAttempts &&
            NamespaceIndentation == R.NamespaceIndentation &&
            ObjCSpaceBeforeProtocolList == R.ObjCSpaceBeforeProtocolList &&
            PenaltyBreakComment == R.PenaltyBreakComment &&
@@ -228,6 +228,10 @@ private:
   /// the preamble must be thrown away.
   llvm::StringMap<std::pair<off_t, time_t> > FilesInPreamble;
 
+  /// \brief The time at which the preamble described by \c FilesInPreamble
+  /// started to be built, in seconds since the epoch.
+  time_t PreambleBuildTime;
+
   /// \brief When non-NULL, this is the buffer used to store the contents of
   /// the main file when it has been padded for use with the precompiled
   /// preamble.
@@ -238,6 +242,29 @@ private:
   /// precompiled preamble.
   llvm::MemoryBuffer *PreambleBuffer;
 
+  /// \brief Keeps track of the files that were read by the last successful
+  /// parse of the main file, with both their size and modification time.
+  ///
+  /// The directories that header lookups went through are recorded as well,
+  /// so that creating a header that would now be found first is noticed. Paths
+  /// that did not exist are recorded with a size of -1.
+  ///
+  /// If none of these have changed and the remapped files are the same,
+  /// \c Reparse() keeps the existing AST rather than rebuilding it.
+  llvm::StringMap<std::pair<off_t, time_t> > FilesInLastParse;
+
+  /// \brief The time at which the last successful parse started, in seconds
+  /// since the epoch.
+  ///
+  /// Modification times only have a resolution of one second, so a file
+  /// whose recorded modification time is not older than this may have been
+  /// changed again without its modification time changing.
+  time_t LastParseTime;
+
+  /// \brief MD5 digest of the remapped file names and buffer contents used by
+  /// the last successful parse, or empty if that parse cannot be reused.
+  SmallString<32> LastParseRemappingDigest;
+
   /// \brief The number of warnings that occurred while parsing the preamble.
   ///
   /// This value will be used to restore the state of the \c DiagnosticsEngine
@@ -394,6 +421,16 @@ private:
                                                         unsigned MaxLines = 0);
   void RealizeTopLevelDeclsFromPreamble();
 
+  /// \brief Try to use a precompiled preamble that another ASTUnit built
+  /// for the same main file, preamble text and options.
+  ///
+  /// \returns true if the shared preamble was adopted, in which case the
+  /// preamble state of this ASTUnit now describes it.
+  bool adoptSharedPreamble(StringRef Key,
+                           const llvm::MemoryBuffer *MainFileBuffer,
+                           unsigned PreambleSize,
+                           CompilerInvocation &PreambleInvocation);
+
   /// \brief Transfers ownership of the objects (like SourceManager) from
   /// \param CI to this ASTUnit.
   void transferASTDataFromCompilerInstance(CompilerInstance &CI);
@@ -686,6 +723,20 @@ private:
   /// \returns \c true if a catastrophic failure occurred (which means that the
   /// \c ASTUnit itself is invalid), or \c false otherwise.
   bool LoadFromCompilerInvocation(bool PrecompilePreamble);
+
+  /// \brief Record the inputs of a successful parse, so that a later
+  /// \c Reparse() with identical inputs can keep the current AST.
+  void recordParseInputs(time_t ParseTime);
+
+  /// \brief Record the directories that header lookups of the last parse
+  /// went through, so that a newly created header that would be found instead
+  /// of one that was read prevents the parse from being reused.
+  void recordHeaderSearchInputs();
+
+  /// \brief Determine whether reparsing with the given remapped files would
+  /// read exactly the same inputs as the last successful parse.
+  bool canReuseLastParse(RemappedFile *RemappedFiles,
+                         unsigned NumRemappedFiles);
   
 public:
   
@@ -789,6 +840,9 @@ public:
   /// \brief Reparse the source files using the same command-line options that
   /// were originally used to produce this translation unit.
   ///
+  /// If neither the remapped files nor any file read by the previous parse
+  /// have changed, the existing AST and diagnostics are kept as-is.
+  ///
   /// \returns True if a failure occurred that causes the ASTUnit not to
   /// contain any translation-unit information, false otherwise.  
   bool Reparse(RemappedFile *RemappedFiles = 0,
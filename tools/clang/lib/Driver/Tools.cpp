@@ -1733,6 +1733,9 @@ static void CollectArgsForIntegratedAssembler(Compilation &C,
     if (UseRelaxAll(C, Args))
       CmdArgs.push_back("-mrelax-all");
 
+    if (Args.hasArg(options::OPT_gz))
+      CmdArgs.push_back("-compress-debug-sections");
+
     // When passing -I arguments to the assembler we sometimes need to
     // unconditionally take the next argument.  For example, when parsing
     // '-Wa,-I -Wa,foo' we need to accept the -Wa,foo arg after seeing the
@@ -1765,6 +1768,9 @@ static void CollectArgsForIntegratedAssembler(Compilation &C,
           CmdArgs.push_back("-fatal-assembler-warnings");
         } else if (Value == "--noexecstack") {
           CmdArgs.push_back("-mnoexecstack");
+        } else if (Value == "--compress-debug-sections" ||
+                   Value == "-compress-debug-sections") {
+          CmdArgs.push_back("-compress-debug-sections");
         } else if (Value.startswith("-I")) {
           CmdArgs.push_back(Value.data());
           // We need to consume the next argument if the current arg is a plain
@@ -18,6 +18,7 @@
 
 #include "Encoding.h"
 #include "clang/Format/Format.h"
+#include "llvm/ADT/Hashing.h"
 
 namespace clang {
 class SourceManager;
@@ -321,6 +322,27 @@ struct LineState {
   }
 };
 
+/// \brief Hashes the fields of \p State that \c ParenState::operator<
+/// compares first; equal states always get equal hashes.
+inline llvm::hash_code hash_value(const ParenState &State) {
+  return llvm::hash_combine(State.Indent, State.LastSpace,
+                            State.BreakBeforeParameter, State.NoLineBreak,
+                            State.ColonPos, State.StartOfFunctionCall);
+}
+
+/// \brief Hashes \p State consistently with \c LineState::operator<, i.e.
+/// leaves out the stack if \c IgnoreStackForComparison is set.
+inline llvm::hash_code hash_value(const LineState &State) {
+  llvm::hash_code Hash = llvm::hash_combine(
+      State.NextToken, State.Column, State.LineContainsContinuedForLoopSection,
+      State.ParenLevel, State.StartOfLineLevel, State.LowestLevelOnLine);
+  Hash = llvm::hash_combine(Hash, State.StartOfStringLiteral);
+  if (State.IgnoreStackForComparison)
+    return Hash;
+  return llvm::hash_combine(
+      Hash, llvm::hash_combine_range(State.Stack.begin(), State.Stack.end()));
+}
+
 } // end namespace format
 } // end namespace clang
 
@@ -136,6 +136,8 @@ template <> struct MappingTraits<clang::format::FormatStyle> {
                    Style.ExperimentalAutoDetectBinPacking);
     IO.mapOptional("IndentCaseLabels", Style.IndentCaseLabels);
     IO.mapOptional("MaxEmptyLinesToKeep", Style.MaxEmptyLinesToKeep);
+    IO.mapOptional("MaxAnalyzedStates", Style.MaxAnalyzedStates);
+    IO.mapOptional("MaxGreedyAttempts", Style.MaxGreedyAttempts);
     IO.mapOptional("NamespaceIndentation", Style.NamespaceIndentation);
     IO.mapOptional("ObjCSpaceBeforeProtocolList",
                    Style.ObjCSpaceBeforeProtocolList);
@@ -210,6 +212,8 @@ FormatStyle getLLVMStyle() {
   LLVMStyle.IndentWidth = 2;
   LLVMStyle.TabWidth = 8;
   LLVMStyle.MaxEmptyLinesToKeep = 1;
+  LLVMStyle.MaxAnalyzedStates = 50000;
+  LLVMStyle.MaxGreedyAttempts = 100;
   LLVMStyle.NamespaceIndentation = FormatStyle::NI_None;
   LLVMStyle.ObjCSpaceBeforeProtocolList = true;
   LLVMStyle.PointerBindsToType = false;
@@ -257,6 +261,8 @@ FormatStyle getGoogleStyle() {
   GoogleStyle.IndentWidth = 2;
   GoogleStyle.TabWidth = 8;
   GoogleStyle.MaxEmptyLinesToKeep = 1;
+  GoogleStyle.MaxAnalyzedStates = 50000;
+  GoogleStyle.MaxGreedyAttempts = 100;
   GoogleStyle.NamespaceIndentation = FormatStyle::NI_None;
   GoogleStyle.ObjCSpaceBeforeProtocolList = false;
   GoogleStyle.PointerBindsToType = true;
@@ -537,6 +543,18 @@ public:
   unsigned format(const SmallVectorImpl<AnnotatedLine *> &Lines, bool DryRun,
                   int AdditionalIndent = 0) {
     assert(!Lines.empty());
+
+    // Nested blocks are dry-run once for every state of the enclosing line
+    // that reaches their closing brace; their penalty only depends on the
+    // lines and the indent, so compute it once.
+    std::pair<const SmallVectorImpl<AnnotatedLine *> *, int> CacheKey(
+        &Lines, AdditionalIndent);
+    if (DryRun) {
+      PenaltyCacheType::const_iterator CacheIt = PenaltyCache.find(CacheKey);
+      if (CacheIt != PenaltyCache.end())
+        return CacheIt->second;
+    }
+
     unsigned Penalty = 0;
     std::vector<int> IndentForLevel;
     for (unsigned i = 0, e = Lines[0]->Level; i != e; ++i)
@@ -653,6 +671,8 @@ public:
       }
       PreviousLine = *I;
     }
+    if (DryRun)
+      PenaltyCache[CacheKey] = Penalty;
     return Penalty;
   }
 
@@ -698,6 +718,24 @@ private:
   typedef std::priority_queue<QueueItem, std::vector<QueueItem>,
                               std::greater<QueueItem> > QueueType;
 
+  /// \brief The states examined by \c analyzeSolutionSpace, keyed by their
+  /// hash so that most lookups do not need to compare whole paren stacks.
+  typedef std::multimap<size_t, const LineState *> SeenStateMap;
+
+  /// \brief Add \p State to \p Seen unless an equal state is already in it.
+  ///
+  /// Returns \c true if \p State was added. \p State must outlive \p Seen.
+  static bool insertSeenState(SeenStateMap &Seen, const LineState &State) {
+    size_t Hash = hash_value(State);
+    std::pair<SeenStateMap::iterator, SeenStateMap::iterator> Range =
+        Seen.equal_range(Hash);
+    for (SeenStateMap::iterator I = Range.first; I != Range.second; ++I)
+      if (!(*I->second < State) && !(State < *I->second))
+        return false;
+    Seen.insert(Range.second, std::make_pair(Hash, &State));
+    return true;
+  }
+
   /// \brief Get the offset of the line relatively to the level.
   ///
   /// For example, 'public:' labels in classes are offset by 1 or 2
@@ -817,9 +855,15 @@ private:
   /// find the shortest path (the one with lowest penalty) from \p InitialState
   /// to a state where all tokens are placed. Returns the penalty.
   ///
+  /// If more than \c FormatStyle::MaxAnalyzedStates states are created, the
+  /// search is abandoned and the cheapest states found so far are completed
+  /// greedily, one after the other, until one of them can be completed. If
+  /// none of the first \c FormatStyle::MaxGreedyAttempts can, the line is
+  /// left alone. Either way the time spent on a single line stays bounded.
+  ///
   /// If \p DryRun is \c false, directly applies the changes.
   unsigned analyzeSolutionSpace(LineState &InitialState, bool DryRun = false) {
-    std::set<LineState> Seen;
+    SeenStateMap Seen;
 
     // Increasing count of \c StateNode items we have created. This is used to
     // create a deterministic order independent of the container.
@@ -833,6 +877,8 @@ private:
     ++Count;
 
     unsigned Penalty = 0;
+    StateNode *Solution = NULL;
+    unsigned GreedyAttempts = 0;
 
     // While not empty, take first element and follow edges.
     while (!Queue.empty()) {
@@ -840,6 +886,7 @@ private:
       StateNode *Node = Queue.top().second;
       if (Node->State.NextToken == NULL) {
         DEBUG(llvm::dbgs() << "\n---\nPenalty for line: " << Penalty << "\n");
+        Solution = Node;
         break;
       }
       Queue.pop();
@@ -849,10 +896,27 @@ private:
       if (Count > 10000)
         Node->State.IgnoreStackForComparison = true;
 
-      if (!Seen.insert(Node->State).second)
+      if (!insertSeenState(Seen, Node->State))
         // State already examined with lower penalty.
         continue;
 
+      // If even that did not keep the search small enough, stop expanding
+      // states and finish the cheapest ones we have greedily instead. The
+      // queue only shrinks from here on, so this always terminates.
+      if (Count > Style.MaxAnalyzedStates) {
+        if (GreedyAttempts++ == Style.MaxGreedyAttempts)
+          break;
+        unsigned GreedyPenalty = Penalty;
+        Solution = completeGreedily(Node, GreedyPenalty);
+        if (Solution) {
+          DEBUG(llvm::dbgs() << "\n---\nGreedy penalty for line: "
+                             << GreedyPenalty << "\n");
+          Penalty = GreedyPenalty;
+          break;
+        }
+        continue;
+      }
+
       FormatDecision LastFormat = Node->State.NextToken->Decision;
       if (LastFormat == FD_Unformatted || LastFormat == FD_Continue)
         addNextStateToQueue(Penalty, Node, /*NewLine=*/false, &Count, &Queue);
@@ -860,7 +924,7 @@ private:
         addNextStateToQueue(Penalty, Node, /*NewLine=*/true, &Count, &Queue);
     }
 
-    if (Queue.empty()) {
+    if (!Solution) {
       // We were unable to find a solution, do nothing.
       // FIXME: Add diagnostic?
       DEBUG(llvm::dbgs() << "Could not find a solution.\n");
@@ -869,7 +933,7 @@ private:
 
     // Reconstruct the solution.
     if (!DryRun)
-      reconstructPath(InitialState, Queue.top().second);
+      reconstructPath(InitialState, Solution);
 
     DEBUG(llvm::dbgs() << "Total number of analyzed states: " << Count << "\n");
     DEBUG(llvm::dbgs() << "---\n");
@@ -877,6 +941,65 @@ private:
     return Penalty;
   }
 
+  /// \brief Place the remaining tokens of \p Node's state, taking the
+  /// cheaper of breaking or not breaking before each token.
+  ///
+  /// Each choice also pays for the characters that the tokens up to the next
+  /// possible break would put past the column limit, so that the greedy pass
+  /// does not run into an overlong line it can no longer break.
+  ///
+  /// Returns the final node, or \c NULL if no valid placement was found.
+  /// \p Penalty must be the penalty of \p Node and is updated to that of
+  /// the returned node.
+  StateNode *completeGreedily(StateNode *Node, unsigned &Penalty) {
+    while (Node->State.NextToken != NULL) {
+      FormatDecision LastFormat = Node->State.NextToken->Decision;
+      StateNode *Best = NULL;
+      unsigned BestPenalty = 0;
+      unsigned BestCost = 0;
+      for (unsigned i = 0; i != 2; ++i) {
+        bool NewLine = i == 1;
+        if ((NewLine && LastFormat == FD_Continue) ||
+            (!NewLine && LastFormat == FD_Break))
+          continue;
+        unsigned NextPenalty = Penalty;
+        StateNode *Next = createNextState(Node, NewLine, NextPenalty);
+        if (!Next)
+          continue;
+        unsigned Cost = NextPenalty + getUnbreakableExcessPenalty(Next->State);
+        if (!Best || Cost < BestCost) {
+          Best = Next;
+          BestPenalty = NextPenalty;
+          BestCost = Cost;
+        }
+      }
+      if (!Best)
+        return NULL;
+      Node = Best;
+      Penalty = BestPenalty;
+    }
+    return Node;
+  }
+
+  /// \brief Returns the excess-character penalty for the tokens following
+  /// \p State that have to stay on its current line, i.e. the ones before
+  /// the next token that can be broken before.
+  unsigned getUnbreakableExcessPenalty(const LineState &State) {
+    if (Style.ColumnLimit == 0)
+      return 0;
+    unsigned Column = State.Column;
+    for (const FormatToken *Tok = State.NextToken; Tok && !Tok->CanBreakBefore;
+         Tok = Tok->Next)
+      Column += Tok->SpacesRequiredBefore + Tok->ColumnWidth;
+    // Characters up to State.Column were already paid for when placing the
+    // previous token.
+    unsigned Limit =
+        std::max(State.Column, getColumnLimit(State.Line->InPPDirective));
+    if (Column <= Limit)
+      return 0;
+    return Style.PenaltyExcessCharacter * (Column - Limit);
+  }
+
   void reconstructPath(LineState &State, StateNode *Current) {
     std::deque<StateNode *> Path;
     // We do not need a break before the initial token.
@@ -906,20 +1029,32 @@ private:
   /// penalty of \p Penalty. Insert a line break if \p NewLine is \c true.
   void addNextStateToQueue(unsigned Penalty, StateNode *PreviousNode,
                            bool NewLine, unsigned *Count, QueueType *Queue) {
-    if (NewLine && !Indenter->canBreak(PreviousNode->State))
+    StateNode *Node = createNextState(PreviousNode, NewLine, Penalty);
+    if (!Node)
       return;
+
+    Queue->push(QueueItem(OrderedPenalty(Penalty, *Count), Node));
+    ++(*Count);
+  }
+
+  /// \brief Create the state following \p PreviousNode, inserting a line
+  /// break if \p NewLine is \c true, and add its cost to \p Penalty.
+  ///
+  /// Returns \c NULL if the next token cannot be placed that way.
+  StateNode *createNextState(StateNode *PreviousNode, bool NewLine,
+                             unsigned &Penalty) {
+    if (NewLine && !Indenter->canBreak(PreviousNode->State))
+      return NULL;
     if (!NewLine && Indenter->mustBreak(PreviousNode->State))
-      return;
+      return NULL;
 
     StateNode *Node = new (Allocator.Allocate())
         StateNode(PreviousNode->State, NewLine, PreviousNode);
     if (!formatChildren(Node->State, NewLine, /*DryRun=*/true, Penalty))
-      return;
+      return NULL;
 
     Penalty += Indenter->addTokenToState(Node->State, NewLine, true);
-
-    Queue->push(QueueItem(OrderedPenalty(Penalty, *Count), Node));
-    ++(*Count);
+    return Node;
   }
 
   /// \brief If the \p State's next token is an r_brace closing a nested block,
@@ -987,6 +1122,12 @@ private:
   LineJoiner Joiner;
 
   llvm::SpecificBumpPtrAllocator<StateNode> Allocator;
+
+  /// \brief Penalties of dry-run formatting a list of lines with a given
+  /// additional indent.
+  typedef std::map<std::pair<const SmallVectorImpl<AnnotatedLine *> *, int>,
+                   unsigned> PenaltyCacheType;
+  PenaltyCacheType PenaltyCache;
 };
 
 class FormatTokenLexer {
@@ -26,6 +26,7 @@
 #include "clang/Frontend/FrontendOptions.h"
 #include "clang/Frontend/MultiplexConsumer.h"
 #include "clang/Frontend/Utils.h"
+#include "clang/Lex/HeaderMap.h"
 #include "clang/Lex/HeaderSearch.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Lex/PreprocessorOptions.h"
@@ -39,10 +40,12 @@
 #include "llvm/Support/CrashRecoveryContext.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Mutex.h"
 #include "llvm/Support/MutexGuard.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/TimeValue.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstdio>
@@ -170,9 +173,78 @@ void OnDiskData::CleanTemporaryFiles() {
   TemporaryFiles.clear();
 }
 
+namespace {
+  /// \brief A precompiled preamble that can be adopted by any ASTUnit that
+  /// parses the same main file with the same preamble text and options.
+  ///
+  /// The preamble file stays on disk for as long as any ASTUnit uses it.
+  struct SharedPreamble {
+    /// \brief The file in which the precompiled preamble is stored.
+    std::string PreambleFile;
+
+    /// \brief The number of ASTUnits currently using this preamble.
+    unsigned RefCount;
+
+    bool EndsAtStartOfLine;
+    unsigned ReservedSize;
+    unsigned TopLevelHashValue;
+    time_t BuildTime;
+    llvm::StringMap<std::pair<off_t, time_t> > FilesInPreamble;
+    std::vector<serialization::DeclID> TopLevelDecls;
+
+    SharedPreamble() : RefCount(0), EndsAtStartOfLine(false), ReservedSize(0),
+                       TopLevelHashValue(0), BuildTime(0) { }
+  };
+}
+
+/// \brief The shared preambles, keyed by the string produced by
+/// \c getSharedPreambleKey(). Protected by the on-disk mutex.
+typedef llvm::StringMap<SharedPreamble> SharedPreambleMap;
+static SharedPreambleMap &getSharedPreambleMap() {
+  // Intentionally leaked: it is still needed when the on-disk data is cleaned
+  // up at exit.
+  static SharedPreambleMap *M = new SharedPreambleMap();
+  return *M;
+}
+
+/// \brief The number of ASTUnits still using each shared preamble file that
+/// has been replaced in the shared preamble map by a newer build. Protected by
+/// the on-disk mutex.
+static llvm::StringMap<unsigned> &getRetiredPreambleMap() {
+  static llvm::StringMap<unsigned> *M = new llvm::StringMap<unsigned>();
+  return *M;
+}
+
+/// \brief Drop one reference to the given preamble file.
+///
+/// \returns true if the file is still in use by another ASTUnit, in which
+/// case it must not be removed.
+static bool releaseSharedPreamble(StringRef PreambleFile) {
+  llvm::MutexGuard Guard(getOnDiskMutex());
+  SharedPreambleMap &M = getSharedPreambleMap();
+  for (SharedPreambleMap::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    if (I->second.PreambleFile != PreambleFile)
+      continue;
+    if (--I->second.RefCount != 0)
+      return true;
+    M.erase(I);
+    return false;
+  }
+
+  llvm::StringMap<unsigned> &Retired = getRetiredPreambleMap();
+  llvm::StringMap<unsigned>::iterator Pos = Retired.find(PreambleFile);
+  if (Pos == Retired.end())
+    return false;
+  if (--Pos->second != 0)
+    return true;
+  Retired.erase(Pos);
+  return false;
+}
+
 void OnDiskData::CleanPreambleFile() {
   if (!PreambleFile.empty()) {
-    llvm::sys::fs::remove(PreambleFile);
+    if (!releaseSharedPreamble(PreambleFile))
+      llvm::sys::fs::remove(PreambleFile);
     PreambleFile.clear();
   }
 }
@@ -223,8 +295,8 @@ ASTUnit::ASTUnit(bool _MainFileIsAST)
     TUKind(TU_Complete), WantTiming(getenv("LIBCLANG_TIMING")),
     OwnsRemappedFileBuffers(true),
     NumStoredDiagnosticsFromDriver(0),
-    PreambleRebuildCounter(0), SavedMainFileBuffer(0), PreambleBuffer(0),
-    NumWarningsInPreamble(0),
+    PreambleRebuildCounter(0), PreambleBuildTime(0), SavedMainFileBuffer(0),
+    PreambleBuffer(0), LastParseTime(0), NumWarningsInPreamble(0),
     ShouldCacheCodeCompletionResults(false),
     IncludeBriefCommentsInCodeCompletion(false), UserFilesAreVolatile(false),
     CompletionCacheTopLevelHashValue(0),
@@ -1111,6 +1183,7 @@ static void checkAndSanitizeDiags(SmallVectorImpl<StoredDiagnostic> &
 /// \returns True if a failure occurred that causes the ASTUnit not to
 /// contain any translation-unit information, false otherwise.
 bool ASTUnit::Parse(llvm::MemoryBuffer *OverrideMainBuffer) {
+  time_t ParseTime = llvm::sys::TimeValue::now().toEpochTime();
   delete SavedMainFileBuffer;
   SavedMainFileBuffer = 0;
   
@@ -1233,9 +1306,13 @@ bool ASTUnit::Parse(llvm::MemoryBuffer *OverrideMainBuffer) {
 
   FailedParseDiagnostics.clear();
 
+  recordParseInputs(ParseTime);
   return false;
 
 error:
+  FilesInLastParse.clear();
+  LastParseRemappingDigest.clear();
+
   // Remove the overridden buffer we used for the preamble.
   if (OverrideMainBuffer) {
     delete OverrideMainBuffer;
@@ -1266,6 +1343,66 @@ static std::string GetPreamblePCHPath() {
   return Path.str();
 }
 
+/// \brief Determine whether the given file no longer has the size and
+/// modification time that were recorded for it.
+static bool fileChangedOnDisk(FileManager &FileMgr, StringRef Filename,
+                              const std::pair<off_t, time_t> &Recorded) {
+  llvm::sys::fs::file_status Status;
+  // If we can't stat the file, assume that something horrible happened.
+  if (FileMgr.getNoncachedStatValue(Filename, Status))
+    return true;
+  return Status.getSize() != uint64_t(Recorded.first) ||
+         Status.getLastModificationTime().toEpochTime() !=
+             uint64_t(Recorded.second);
+}
+
+/// \brief Compute the key under which a precompiled preamble built from the
+/// given invocation and preamble text can be shared with other ASTUnits.
+///
+/// \returns false if the preamble cannot be shared, e.g., because it depends
+/// on remapped files whose contents are not part of the key.
+static bool getSharedPreambleKey(const CompilerInvocation &Invocation,
+                                 StringRef PreambleText, std::string &Key) {
+  // Crash-recovery tests force every preamble into the same file.
+  if (::getenv("CINDEXTEST_PREAMBLE_FILE"))
+    return false;
+
+  StringRef MainFilePath = Invocation.getFrontendOpts().Inputs[0].getFile();
+  const PreprocessorOptions &PPOpts = Invocation.getPreprocessorOpts();
+  for (PreprocessorOptions::const_remapped_file_iterator
+         R = PPOpts.remapped_file_begin(), REnd = PPOpts.remapped_file_end();
+       R != REnd; ++R)
+    if (R->first != MainFilePath)
+      return false;
+  for (PreprocessorOptions::const_remapped_file_buffer_iterator
+         R = PPOpts.remapped_file_buffer_begin(),
+         REnd = PPOpts.remapped_file_buffer_end();
+       R != REnd; ++R)
+    if (R->first != MainFilePath)
+      return false;
+
+  // The module hash covers the language, target and macro options; add the
+  // options that decide which headers the preamble finds.
+  const HeaderSearchOptions &HSOpts = Invocation.getHeaderSearchOpts();
+  llvm::raw_string_ostream OS(Key);
+  OS << Invocation.getModuleHash() << '\0' << MainFilePath << '\0'
+     << HSOpts.ResourceDir << '\0' << PPOpts.ImplicitPCHInclude << '\0';
+  for (unsigned I = 0, N = HSOpts.UserEntries.size(); I != N; ++I) {
+    const HeaderSearchOptions::Entry &E = HSOpts.UserEntries[I];
+    OS << E.Path << '\0' << unsigned(E.Group) << unsigned(E.IsFramework)
+       << unsigned(E.IgnoreSysRoot) << '\0';
+  }
+  for (unsigned I = 0, N = PPOpts.Macros.size(); I != N; ++I)
+    OS << PPOpts.Macros[I].first << '\0' << PPOpts.Macros[I].second << '\0';
+  for (unsigned I = 0, N = PPOpts.Includes.size(); I != N; ++I)
+    OS << PPOpts.Includes[I] << '\0';
+  for (unsigned I = 0, N = PPOpts.MacroIncludes.size(); I != N; ++I)
+    OS << PPOpts.MacroIncludes[I] << '\0';
+  OS << PreambleText;
+  OS.flush();
+  return true;
+}
+
 /// \brief Compute the preamble for the main file, providing the source buffer
 /// that corresponds to the main file along with a pair (bytes, start-of-line)
 /// that describes the preamble.
@@ -1516,6 +1653,22 @@ llvm::MemoryBuffer *ASTUnit::getMainBufferWithPrecompiledPreamble(
     return 0;
   }
 
+  // If another ASTUnit has already precompiled this preamble, adopt it rather
+  // than building our own copy.
+  std::string SharedKey;
+  bool CanSharePreamble
+    = getSharedPreambleKey(PreambleInvocationIn,
+                           StringRef(NewPreamble.first->getBufferStart(),
+                                     NewPreamble.second.first),
+                           SharedKey);
+  if (CanSharePreamble &&
+      adoptSharedPreamble(SharedKey, NewPreamble.first,
+                          NewPreamble.second.first, *PreambleInvocation)) {
+    return CreatePaddedMainFileBuffer(NewPreamble.first,
+                                      PreambleReservedSize,
+                                      FrontendOpts.Inputs[0].getFile());
+  }
+
   // If the preamble rebuild counter > 1, it's because we previously
   // failed to build a preamble and we're not yet ready to try
   // again. Decrement the counter and return a failure.
@@ -1536,6 +1689,7 @@ llvm::MemoryBuffer *ASTUnit::getMainBufferWithPrecompiledPreamble(
   // We did not previously compute a preamble, or it can't be reused anyway.
   SimpleTimer PreambleTimer(WantTiming);
   PreambleTimer.setOutput("Precompiling preamble");
+  time_t BuildTime = llvm::sys::TimeValue::now().toEpochTime();
   
   // Create a new buffer that stores the preamble. The buffer also contains
   // extra space for the original contents of the file (which will be present
@@ -1669,6 +1823,7 @@ llvm::MemoryBuffer *ASTUnit::getMainBufferWithPrecompiledPreamble(
   
   // Keep track of all of the files that the source manager knows about,
   // so we can verify whether they have changed or not.
+  PreambleBuildTime = BuildTime;
   FilesInPreamble.clear();
   SourceManager &SourceMgr = Clang->getSourceManager();
   const llvm::MemoryBuffer *MainFileBuffer
@@ -1696,12 +1851,93 @@ llvm::MemoryBuffer *ASTUnit::getMainBufferWithPrecompiledPreamble(
     CompletionCacheTopLevelHashValue = 0;
     PreambleTopLevelHashValue = CurrentTopLevelHashValue;
   }
+
+  // Offer a clean preamble to other ASTUnits; stored diagnostics refer to
+  // our source manager, so preambles with diagnostics are kept private.
+  if (CanSharePreamble && PreambleDiagnostics.empty() &&
+      NumWarningsInPreamble == 0) {
+    llvm::MutexGuard Guard(getOnDiskMutex());
+    SharedPreamble &Shared = getSharedPreambleMap()[SharedKey];
+    // We only get here if a registered preamble could not be adopted, because
+    // it is stale or too small. Replace it, keeping count of its remaining
+    // users so that its file is removed once the last of them lets go of it.
+    if (Shared.RefCount != 0)
+      getRetiredPreambleMap()[Shared.PreambleFile] += Shared.RefCount;
+    Shared.PreambleFile = FrontendOpts.OutputFile;
+    Shared.RefCount = 1;
+    Shared.EndsAtStartOfLine = PreambleEndsAtStartOfLine;
+    Shared.ReservedSize = PreambleReservedSize;
+    Shared.TopLevelHashValue = CurrentTopLevelHashValue;
+    Shared.BuildTime = PreambleBuildTime;
+    Shared.FilesInPreamble = FilesInPreamble;
+    Shared.TopLevelDecls = TopLevelDeclsInPreamble;
+  }
   
   return CreatePaddedMainFileBuffer(NewPreamble.first, 
                                     PreambleReservedSize,
                                     FrontendOpts.Inputs[0].getFile());
 }
 
+bool ASTUnit::adoptSharedPreamble(StringRef Key,
+                                  const llvm::MemoryBuffer *MainFileBuffer,
+                                  unsigned PreambleSize,
+                                  CompilerInvocation &PreambleInvocation) {
+  llvm::MutexGuard Guard(getOnDiskMutex());
+  SharedPreambleMap &M = getSharedPreambleMap();
+  SharedPreambleMap::iterator Pos = M.find(Key);
+  if (Pos == M.end())
+    return false;
+
+  SharedPreamble &Shared = Pos->second;
+  if (MainFileBuffer->getBufferSize() >= Shared.ReservedSize - 2)
+    return false;
+
+  // The preamble may have been built some time ago; make sure none of the
+  // files it depends on have changed since.
+  for (llvm::StringMap<std::pair<off_t, time_t> >::iterator
+         F = Shared.FilesInPreamble.begin(), FEnd = Shared.FilesInPreamble.end();
+       F != FEnd; ++F) {
+    if (fileChangedOnDisk(getFileManager(), F->first(), F->second))
+      return false;
+  }
+
+  SimpleTimer AdoptTimer(WantTiming);
+  AdoptTimer.setOutput("Adopting shared preamble");
+
+  ++Shared.RefCount;
+  erasePreambleFile(this);
+  setPreambleFile(this, Shared.PreambleFile);
+
+  StringRef MainFilename
+    = PreambleInvocation.getFrontendOpts().Inputs[0].getFile();
+  Preamble.assign(FileMgr->getFile(MainFilename),
+                  MainFileBuffer->getBufferStart(),
+                  MainFileBuffer->getBufferStart() + PreambleSize);
+  PreambleEndsAtStartOfLine = Shared.EndsAtStartOfLine;
+  PreambleReservedSize = Shared.ReservedSize;
+  PreambleBuildTime = Shared.BuildTime;
+  FilesInPreamble = Shared.FilesInPreamble;
+  TopLevelDeclsInPreamble = Shared.TopLevelDecls;
+  OriginalSourceFile = MainFilename;
+  PreambleDiagnostics.clear();
+  NumWarningsInPreamble = 0;
+  PreambleRebuildCounter = 1;
+
+  // Set the state of the diagnostic object to mimic its state after
+  // parsing the preamble.
+  getDiagnostics().Reset();
+  ProcessWarningOptions(getDiagnostics(),
+                        PreambleInvocation.getDiagnosticOpts());
+  checkAndRemoveNonDriverDiags(StoredDiagnostics);
+
+  CurrentTopLevelHashValue = Shared.TopLevelHashValue;
+  if (CurrentTopLevelHashValue != PreambleTopLevelHashValue) {
+    CompletionCacheTopLevelHashValue = 0;
+    PreambleTopLevelHashValue = CurrentTopLevelHashValue;
+  }
+  return true;
+}
+
 void ASTUnit::RealizeTopLevelDeclsFromPreamble() {
   std::vector<Decl *> Resolved;
   Resolved.reserve(TopLevelDeclsInPreamble.size());
@@ -2077,15 +2313,243 @@ ASTUnit *ASTUnit::LoadFromCommandLine(const char **ArgBegin,
   return AST.take();
 }
 
+/// \brief Add a remapped file, including the contents of its buffer, to the
+/// digest used to detect whether the inputs of a parse have changed.
+static void addRemappedBufferToHash(llvm::MD5 &Hash, StringRef Filename,
+                                    const llvm::MemoryBuffer *Buffer) {
+  Hash.update(Filename);
+  Hash.update(StringRef("\0", 1));
+  Hash.update(Buffer->getBuffer());
+  Hash.update(StringRef("\0", 1));
+}
+
+/// \brief Record the current size and modification time of the given file or
+/// directory, or that it does not exist.
+static void recordInputState(FileManager &FileMgr, StringRef Path,
+                        llvm::StringMap<std::pair<off_t, time_t> > &Inputs) {
+  if (Inputs.count(Path))
+    return;
+  llvm::sys::fs::file_status Status;
+  if (FileMgr.getNoncachedStatValue(Path, Status)) {
+    Inputs[Path] = std::make_pair(off_t(-1), time_t(0));
+    return;
+  }
+  Inputs[Path] = std::make_pair(off_t(Status.getSize()),
+                     time_t(Status.getLastModificationTime().toEpochTime()));
+}
+
+/// \brief Determine whether the given input of a parse that started at
+/// \p ParseTime may have changed since.
+static bool inputChangedSince(FileManager &FileMgr, StringRef Path,
+                              const std::pair<off_t, time_t> &Recorded,
+                              time_t ParseTime) {
+  // The path did not exist; it has changed if it does now.
+  if (Recorded.first == -1) {
+    llvm::sys::fs::file_status Status;
+    return !FileMgr.getNoncachedStatValue(Path, Status);
+  }
+
+  // The input was modified during the second in which the parse started, so
+  // it could have been modified again without its modification time changing.
+  if (Recorded.second >= ParseTime)
+    return true;
+
+  return fileChangedOnDisk(FileMgr, Path, Recorded);
+}
+
+void ASTUnit::recordParseInputs(time_t ParseTime) {
+  FilesInLastParse.clear();
+  LastParseRemappingDigest.clear();
+  LastParseTime = ParseTime;
+
+  // A parse with errors may have failed to find a header that exists by now;
+  // always reparse in that case.
+  if (getDiagnostics().hasErrorOccurred())
+    return;
+  for (stored_diag_iterator D = stored_diag_begin(), DEnd = stored_diag_end();
+       D != DEnd; ++D) {
+    if (D->getLevel() >= DiagnosticsEngine::Error)
+      return;
+  }
+
+  // File-to-file remappings can change behind our back, so don't try to
+  // reuse a parse that depended on them.
+  PreprocessorOptions &PPOpts = Invocation->getPreprocessorOpts();
+  if (PPOpts.remapped_file_begin() != PPOpts.remapped_file_end())
+    return;
+
+  llvm::MD5 Hash;
+  llvm::StringSet<> RemappedNames;
+  for (PreprocessorOptions::remapped_file_buffer_iterator
+         R = PPOpts.remapped_file_buffer_begin(),
+         REnd = PPOpts.remapped_file_buffer_end();
+       R != REnd; ++R) {
+    addRemappedBufferToHash(Hash, R->first, R->second);
+    RemappedNames.insert(R->first);
+  }
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  llvm::MD5::stringifyResult(Result, LastParseRemappingDigest);
+
+  for (SourceManager::fileinfo_iterator F = SourceMgr->fileinfo_begin(),
+                                        FEnd = SourceMgr->fileinfo_end();
+       F != FEnd; ++F) {
+    const FileEntry *File = F->first;
+    if (!F->second->BufferOverridden) {
+      FilesInLastParse[File->getName()]
+        = std::make_pair(File->getSize(), File->getModificationTime());
+      continue;
+    }
+
+    // Remapped buffers are covered by the digest.
+    if (RemappedNames.count(File->getName()))
+      continue;
+
+    // The main file was overridden by the padded buffer we use with the
+    // precompiled preamble; its file entry describes that buffer, so record
+    // the state of the file on disk instead.
+    llvm::sys::fs::file_status Status;
+    if (getFileManager().getNoncachedStatValue(File->getName(), Status)) {
+      FilesInLastParse.clear();
+      LastParseRemappingDigest.clear();
+      return;
+    }
+    FilesInLastParse[File->getName()] = std::make_pair(
+        Status.getSize(), Status.getLastModificationTime().toEpochTime());
+  }
+
+  recordHeaderSearchInputs();
+}
+
+void ASTUnit::recordHeaderSearchInputs() {
+  // Collect the normal search directories, and record the ones that can't
+  // be used to locate files relative to them.
+  SmallVector<StringRef, 16> SearchDirs;
+  HeaderSearch &HS = PP->getHeaderSearchInfo();
+  for (HeaderSearch::search_dir_iterator D = HS.search_dir_begin(),
+                                         DEnd = HS.search_dir_end();
+       D != DEnd; ++D) {
+    if (const DirectoryEntry *Dir = D->getDir())
+      SearchDirs.push_back(Dir->getName());
+    else if (const DirectoryEntry *Dir = D->getFrameworkDir())
+      recordInputState(getFileManager(), Dir->getName(), FilesInLastParse);
+    else if (const HeaderMap *HM = D->getHeaderMap())
+      recordInputState(getFileManager(), HM->getFileName(), FilesInLastParse);
+  }
+
+  // A header that is created in a directory searched before the one where an
+  // included file was found would be picked up by the next parse. Record
+  // the directory of every file that was read, since quoted includes are
+  // looked up there first, and the directory that would hold a file of the
+  // same relative name in every search directory. Creating a file in one of
+  // these directories changes its modification time.
+  SmallVector<std::string, 64> InputFiles;
+  for (llvm::StringMap<std::pair<off_t, time_t> >::iterator
+         F = FilesInLastParse.begin(), FEnd = FilesInLastParse.end();
+       F != FEnd; ++F)
+    InputFiles.push_back(F->first());
+  for (llvm::StringMap<std::pair<off_t, time_t> >::iterator
+         F = FilesInPreamble.begin(), FEnd = FilesInPreamble.end();
+       F != FEnd; ++F)
+    InputFiles.push_back(F->first());
+
+  for (unsigned I = 0, N = InputFiles.size(); I != N; ++I) {
+    StringRef File = InputFiles[I];
+    StringRef Dir = llvm::sys::path::parent_path(File);
+    if (!Dir.empty())
+      recordInputState(getFileManager(), Dir, FilesInLastParse);
+
+    for (unsigned D = 0, DN = SearchDirs.size(); D != DN; ++D) {
+      StringRef SearchDir = SearchDirs[D];
+      if (!File.startswith(SearchDir) || File.size() <= SearchDir.size() ||
+          !llvm::sys::path::is_separator(File[SearchDir.size()]))
+        continue;
+      StringRef RelativeDir =
+          llvm::sys::path::parent_path(File.substr(SearchDir.size() + 1));
+      for (unsigned O = 0; O != DN; ++O) {
+        SmallString<128> Path(SearchDirs[O]);
+        llvm::sys::path::append(Path, RelativeDir);
+        recordInputState(getFileManager(), Path, FilesInLastParse);
+      }
+    }
+  }
+}
+
+bool ASTUnit::canReuseLastParse(RemappedFile *RemappedFiles,
+                                unsigned NumRemappedFiles) {
+  // We can only drop the new remapped buffers on the floor if we own them.
+  if (LastParseRemappingDigest.empty() || !Ctx || !OwnsRemappedFileBuffers)
+    return false;
+
+  // If this reparse is the one that should build the precompiled preamble,
+  // don't skip it; otherwise the first edit would pay for the preamble too.
+  if (PreambleRebuildCounter == 1 && getPreambleFile(this).empty())
+    return false;
+
+  llvm::MD5 Hash;
+  llvm::StringSet<> RemappedNames;
+  for (unsigned I = 0; I != NumRemappedFiles; ++I) {
+    const llvm::MemoryBuffer *Buffer
+      = RemappedFiles[I].second.dyn_cast<const llvm::MemoryBuffer *>();
+    if (!Buffer)
+      return false;
+    addRemappedBufferToHash(Hash, RemappedFiles[I].first, Buffer);
+    RemappedNames.insert(RemappedFiles[I].first);
+  }
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Digest;
+  llvm::MD5::stringifyResult(Result, Digest);
+  if (Digest != LastParseRemappingDigest)
+    return false;
+
+  // The remapped contents are identical; check that none of the files we
+  // read from disk, either directly or through the preamble, have changed.
+  for (llvm::StringMap<std::pair<off_t, time_t> >::iterator
+         F = FilesInLastParse.begin(), FEnd = FilesInLastParse.end();
+       F != FEnd; ++F) {
+    if (!RemappedNames.count(F->first()) &&
+        inputChangedSince(getFileManager(), F->first(), F->second,
+                          LastParseTime))
+      return false;
+  }
+  for (llvm::StringMap<std::pair<off_t, time_t> >::iterator
+         F = FilesInPreamble.begin(), FEnd = FilesInPreamble.end();
+       F != FEnd; ++F) {
+    if (!RemappedNames.count(F->first()) &&
+        inputChangedSince(getFileManager(), F->first(), F->second,
+                          PreambleBuildTime))
+      return false;
+  }
+
+  return true;
+}
+
 bool ASTUnit::Reparse(RemappedFile *RemappedFiles, unsigned NumRemappedFiles) {
   if (!Invocation)
     return true;
 
-  clearFileLevelDecls();
-  
   SimpleTimer ParsingTimer(WantTiming);
   ParsingTimer.setOutput("Reparsing " + getMainFileName());
 
+  // If nothing that the last parse read has changed, keep the current AST.
+  // The remapped buffers in the invocation are still referenced by the
+  // current source manager, so release the new (identical) ones instead.
+  if (canReuseLastParse(RemappedFiles, NumRemappedFiles)) {
+    ParsingTimer.setOutput("Reusing AST for " + getMainFileName());
+    for (unsigned I = 0; I != NumRemappedFiles; ++I)
+      delete RemappedFiles[I].second.get<const llvm::MemoryBuffer *>();
+
+    // The completion cache may still be stale, e.g. when the preamble was
+    // adopted from another unit, so refresh it just like a full reparse.
+    if (ShouldCacheCodeCompletionResults &&
+        CurrentTopLevelHashValue != CompletionCacheTopLevelHashValue)
+      CacheCodeCompletionResults();
+    return false;
+  }
+
+  clearFileLevelDecls();
+
   // Remap files.
   PreprocessorOptions &PPOpts = Invocation->getPreprocessorOpts();
   for (PreprocessorOptions::remapped_file_buffer_iterator 
@@ -2298,6 +2762,18 @@ void AugmentedCodeCompleteConsumer::ProcessCodeCompleteResults(Sema &S,
   llvm::StringSet<llvm::BumpPtrAllocator> HiddenNames;
   typedef CodeCompletionResult Result;
   SmallVector<Result, 8> AllResults;
+
+  // Classify the preferred type once, rather than for every cached result.
+  CanQualType Expected;
+  SimplifiedTypeClass ExpectedSTC = STC_Other;
+  unsigned ExpectedType = 0;
+  bool ExpectedTypeResolved = false;
+  if (!Context.getPreferredType().isNull()) {
+    Expected = S.Context.getCanonicalType(
+                             Context.getPreferredType().getUnqualifiedType());
+    ExpectedSTC = getSimplifiedTypeClass(Expected);
+  }
+
   for (ASTUnit::cached_completion_iterator 
             C = AST.cached_completion_begin(),
          CEnd = AST.cached_completion_end();
@@ -2330,17 +2806,19 @@ void AugmentedCodeCompleteConsumer::ProcessCodeCompleteResults(Sema &S,
                                          S.getLangOpts(),
                                Context.getPreferredType()->isAnyPointerType());        
       } else if (C->Type) {
-        CanQualType Expected
-          = S.Context.getCanonicalType(
-                               Context.getPreferredType().getUnqualifiedType());
-        SimplifiedTypeClass ExpectedSTC = getSimplifiedTypeClass(Expected);
         if (ExpectedSTC == C->TypeClass) {
-          // We know this type is similar; check for an exact match.
-          llvm::StringMap<unsigned> &CachedCompletionTypes
-            = AST.getCachedCompletionTypes();
-          llvm::StringMap<unsigned>::iterator Pos
-            = CachedCompletionTypes.find(QualType(Expected).getAsString());
-          if (Pos != CachedCompletionTypes.end() && Pos->second == C->Type)
+          // We know this type is similar; check for an exact match. Looking
+          // up the expected type requires printing it, so only do so once.
+          if (!ExpectedTypeResolved) {
+            llvm::StringMap<unsigned> &CachedCompletionTypes
+              = AST.getCachedCompletionTypes();
+            llvm::StringMap<unsigned>::iterator Pos
+              = CachedCompletionTypes.find(QualType(Expected).getAsString());
+            if (Pos != CachedCompletionTypes.end())
+              ExpectedType = Pos->second;
+            ExpectedTypeResolved = true;
+          }
+          if (ExpectedType && ExpectedType == C->Type)
             Priority /= CCF_ExactTypeMatch;
           else
             Priority /= CCF_SimilarTypeMatch;
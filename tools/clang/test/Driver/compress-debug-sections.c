@@ -0,0 +1,6 @@
+// RUN: %clang -### %s -c -o tmp.o -target x86_64-pc-linux-gnu -integrated-as -Wa,--compress-debug-sections 2>&1 | FileCheck %s
+// RUN: %clang -### %s -c -o tmp.o -target x86_64-pc-linux-gnu -integrated-as -g -gz 2>&1 | FileCheck %s
+// RUN: %clang -### %s -c -o tmp.o -target x86_64-pc-linux-gnu -integrated-as -g 2>&1 | FileCheck %s -check-prefix=NOCOMPRESS
+
+// CHECK: "-cc1" {{.*}} "-compress-debug-sections"
+// NOCOMPRESS-NOT: "-compress-debug-sections"
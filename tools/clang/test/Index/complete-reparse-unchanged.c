@@ -0,0 +1,18 @@
+#include "complete-reparse-unchanged.h"
+
+int main_global;
+
+void use_globals(void) {
+  main_global = header_global;
+}
+
+// Code completion after a reparse that kept the AST still offers the cached
+// global results.
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_COMPLETION_CACHING=1 \
+// RUN:   CINDEXTEST_COMPLETION_REPARSES=3 LIBCLANG_TIMING=1 \
+// RUN:   c-index-test -code-completion-at=%s:6:3 -I%S/Inputs %s 2> %t.err \
+// RUN:   | FileCheck %s
+// RUN: FileCheck -check-prefix=CHECK-TIMING < %t.err %s
+// CHECK: VarDecl:{ResultType int}{TypedText header_global} (50)
+// CHECK: VarDecl:{ResultType int}{TypedText main_global} (50)
+// CHECK-TIMING: Reusing AST for {{.*}}complete-reparse-unchanged.c
@@ -0,0 +1,33 @@
+#include "pragma_disable_warning.h"
+#ifdef MISSING
+#include "reparse-unchanged-missing.h"
+#endif
+
+int unused_param(int x) {
+  int y;
+  return 0;
+}
+
+// Reparsing without changing any input keeps the AST and its diagnostics.
+// RUN: env CINDEXTEST_EDITING=1 c-index-test -test-load-source-reparse 5 local \
+// RUN:   -I%S/Inputs %s -Wall 2> %t.err | FileCheck %s
+// RUN: FileCheck -check-prefix=CHECK-DIAG < %t.err %s
+// CHECK: reparse-unchanged.c:6:5: FunctionDecl=unused_param:6:5 (Definition)
+// CHECK: reparse-unchanged.c:7:7: VarDecl=y:7:7 (Definition) Extent=[7:3 - 7:8]
+// CHECK-DIAG: reparse-unchanged.c:7:7: warning: unused variable 'y'
+
+// The AST is kept rather than rebuilt on every reparse.
+// RUN: env CINDEXTEST_EDITING=1 LIBCLANG_TIMING=1 c-index-test \
+// RUN:   -test-load-source-reparse 5 local -I%S/Inputs %s -Wall 2>&1 \
+// RUN:   | FileCheck -check-prefix=CHECK-REUSE %s
+// CHECK-REUSE: Reusing AST for {{.*}}reparse-unchanged.c
+// CHECK-REUSE-NOT: Reparsing {{.*}}reparse-unchanged.c
+
+// A parse that could not find a header is never reused, since the header
+// may have been created in the meantime.
+// RUN: env CINDEXTEST_EDITING=1 LIBCLANG_TIMING=1 c-index-test \
+// RUN:   -test-load-source-reparse 5 local -I%S/Inputs %s -DMISSING 2>&1 \
+// RUN:   | FileCheck -check-prefix=CHECK-MISSING %s
+// CHECK-MISSING: 'reparse-unchanged-missing.h' file not found
+// CHECK-MISSING: Reparsing {{.*}}reparse-unchanged.c
+// CHECK-MISSING-NOT: Reusing AST for
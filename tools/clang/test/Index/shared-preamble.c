@@ -0,0 +1,38 @@
+#include "pragma_disable_warning.h"
+
+int shared_preamble(int x) {
+  return x;
+}
+
+// Translation units of the same file share one precompiled preamble for as
+// long as any of them uses it.
+// RUN: env CINDEXTEST_EDITING=1 LIBCLANG_TIMING=1 \
+// RUN:   c-index-test -test-shared-preamble -I%S/Inputs %s 2>&1 | FileCheck %s
+// CHECK: Loading translation unit 0
+// CHECK-NOT: Adopting shared preamble
+// CHECK: Precompiling preamble
+// CHECK: Loading translation unit 1
+// CHECK-NOT: Precompiling preamble
+// CHECK: Adopting shared preamble
+// CHECK: Disposing translation unit 0
+// CHECK: Loading translation unit 2
+// CHECK-NOT: Precompiling preamble
+// CHECK: Adopting shared preamble
+// CHECK: Disposing translation unit 1
+// CHECK: Disposing translation unit 2
+// CHECK: Loading translation unit 3
+// CHECK-NOT: Adopting shared preamble
+// CHECK: Precompiling preamble
+// CHECK: Disposing translation unit 3
+
+// Units that adopt a shared preamble still build the global completion cache.
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_COMPLETION_CACHING=1 \
+// RUN:   LIBCLANG_TIMING=1 c-index-test -test-shared-preamble -I%S/Inputs %s \
+// RUN:   2>&1 | FileCheck -check-prefix=CHECK-CACHE %s
+// CHECK-CACHE: Loading translation unit 1
+// CHECK-CACHE: Adopting shared preamble
+// CHECK-CACHE: Cache global code completions for {{.*}}shared-preamble.c
+// CHECK-CACHE: Loading translation unit 2
+// CHECK-CACHE: Adopting shared preamble
+// CHECK-CACHE: Cache global code completions for {{.*}}shared-preamble.c
+// CHECK-CACHE: Disposing translation unit 1
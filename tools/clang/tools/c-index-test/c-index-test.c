@@ -1473,6 +1473,68 @@ int perform_test_reparse_source(int argc, const char **argv, int trials,
   return result;
 }
 
+/* Parse and reparse a translation unit for the given arguments, so that it
+ * has a precompiled preamble. */
+static CXTranslationUnit load_shared_preamble_tu(CXIndex Idx, int argc,
+                                                 const char **argv,
+                                                 unsigned Index) {
+  CXTranslationUnit TU;
+  fprintf(stderr, "Loading translation unit %u\n", Index);
+  TU = clang_parseTranslationUnit(Idx, 0, argv, argc, 0, 0,
+                                  getDefaultParsingOptions());
+  if (!TU) {
+    fprintf(stderr, "Unable to load translation unit!\n");
+    return 0;
+  }
+  if (clang_reparseTranslationUnit(TU, 0, 0, clang_defaultReparseOptions(TU))) {
+    fprintf(stderr, "Unable to reparse translation unit!\n");
+    clang_disposeTranslationUnit(TU);
+    return 0;
+  }
+  return TU;
+}
+
+static void dispose_shared_preamble_tu(CXTranslationUnit TU, unsigned Index) {
+  fprintf(stderr, "Disposing translation unit %u\n", Index);
+  clang_disposeTranslationUnit(TU);
+}
+
+/* Load several translation units of the same file, checking (through the
+ * LIBCLANG_TIMING output) that they share one precompiled preamble for as
+ * long as any of them is alive. */
+int perform_test_shared_preamble(int argc, const char **argv) {
+  CXIndex Idx;
+  CXTranslationUnit TUs[4];
+
+  Idx = clang_createIndex(/* excludeDeclsFromPCH */1,
+                          /* displayDiagnostics=*/1);
+
+  /* The first unit precompiles the preamble; the second adopts it. */
+  if (!(TUs[0] = load_shared_preamble_tu(Idx, argc, argv, 0)))
+    goto fail;
+  if (!(TUs[1] = load_shared_preamble_tu(Idx, argc, argv, 1)))
+    goto fail;
+
+  /* The preamble outlives the unit that built it. */
+  dispose_shared_preamble_tu(TUs[0], 0);
+  if (!(TUs[2] = load_shared_preamble_tu(Idx, argc, argv, 2)))
+    goto fail;
+
+  /* Once no unit uses it, the preamble is gone and is built again. */
+  dispose_shared_preamble_tu(TUs[1], 1);
+  dispose_shared_preamble_tu(TUs[2], 2);
+  if (!(TUs[3] = load_shared_preamble_tu(Idx, argc, argv, 3)))
+    goto fail;
+  dispose_shared_preamble_tu(TUs[3], 3);
+
+  clang_disposeIndex(Idx);
+  return 0;
+
+fail:
+  clang_disposeIndex(Idx);
+  return 1;
+}
+
 /******************************************************************************/
 /* Logic for testing clang_getCursor().                                       */
 /******************************************************************************/
@@ -1878,7 +1940,7 @@ int perform_code_completion(int argc, const char **argv, int timing_only) {
   int num_unsaved_files = 0;
   CXCodeCompleteResults *results = 0;
   CXTranslationUnit TU = 0;
-  unsigned I, Repeats = 1;
+  unsigned I, Repeats = 1, Reparses = 1;
   unsigned completionOptions = clang_defaultCodeCompleteOptions();
   
   if (getenv("CINDEXTEST_CODE_COMPLETE_PATTERNS"))
@@ -1902,6 +1964,8 @@ int perform_code_completion(int argc, const char **argv, int timing_only) {
   
   if (getenv("CINDEXTEST_EDITING"))
     Repeats = 5;
+  if (getenv("CINDEXTEST_COMPLETION_REPARSES"))
+    Reparses = atoi(getenv("CINDEXTEST_COMPLETION_REPARSES"));
   
   TU = clang_parseTranslationUnit(CIdx, 0,
                                   argv + num_unsaved_files + 2,
@@ -1912,9 +1976,12 @@ int perform_code_completion(int argc, const char **argv, int timing_only) {
     return 1;
   }
 
-  if (clang_reparseTranslationUnit(TU, 0, 0, clang_defaultReparseOptions(TU))) {
-    fprintf(stderr, "Unable to reparse translation init!\n");
-    return 1;
+  for (I = 0; I != Reparses; ++I) {
+    if (clang_reparseTranslationUnit(TU, 0, 0,
+                                     clang_defaultReparseOptions(TU))) {
+      fprintf(stderr, "Unable to reparse translation init!\n");
+      return 1;
+    }
   }
   
   for (I = 0; I != Repeats; ++I) {
@@ -3766,6 +3833,8 @@ static void print_usage(void) {
     "       c-index-test -test-annotate-tokens=<range> {<args>}*\n"
     "       c-index-test -test-inclusion-stack-source {<args>}*\n"
     "       c-index-test -test-inclusion-stack-tu <AST file>\n");
+  fprintf(stderr,
+    "       c-index-test -test-shared-preamble {<args>}*\n");
   fprintf(stderr,
     "       c-index-test -test-print-linkage-source {<args>}*\n"
     "       c-index-test -test-print-type {<args>}*\n"
@@ -3828,6 +3897,8 @@ int cindextest_main(int argc, const char **argv) {
                                          NULL);
     }
   }
+  else if (argc > 2 && strcmp(argv[1], "-test-shared-preamble") == 0)
+    return perform_test_shared_preamble(argc - 2, argv + 2);
   else if (argc >= 4 && strncmp(argv[1], "-test-load-source", 17) == 0) {
     CXCursorVisitor I = GetVisitor(argv[1] + 17);
     
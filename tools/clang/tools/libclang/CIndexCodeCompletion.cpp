@@ -966,18 +966,15 @@ static StringRef GetTypedName(CodeCompletionString *String,
 }
 
 namespace {
+  /// \brief A code-completion result paired with its typed text, which is
+  /// computed once up front rather than on every comparison.
+  typedef std::pair<StringRef, CXCompletionResult> TypedCompletionResult;
+
   struct OrderCompletionResults {
-    bool operator()(const CXCompletionResult &XR, 
-                    const CXCompletionResult &YR) const {
-      CodeCompletionString *X
-        = (CodeCompletionString *)XR.CompletionString;
-      CodeCompletionString *Y
-        = (CodeCompletionString *)YR.CompletionString;
-      
-      SmallString<256> XBuffer;
-      StringRef XText = GetTypedName(X, XBuffer);
-      SmallString<256> YBuffer;
-      StringRef YText = GetTypedName(Y, YBuffer);
+    bool operator()(const TypedCompletionResult &XR,
+                    const TypedCompletionResult &YR) const {
+      StringRef XText = XR.first;
+      StringRef YText = YR.first;
       
       if (XText.empty() || YText.empty())
         return !XText.empty();
@@ -997,6 +994,26 @@ namespace {
 extern "C" {
   void clang_sortCodeCompletionResults(CXCompletionResult *Results,
                                        unsigned NumResults) {
-    std::stable_sort(Results, Results + NumResults, OrderCompletionResults());
+    // Typed text that spans several chunks has to be concatenated; keep
+    // those copies alive until the sort is done.
+    llvm::BumpPtrAllocator TextAlloc;
+    std::vector<TypedCompletionResult> Typed;
+    Typed.reserve(NumResults);
+    for (unsigned I = 0; I != NumResults; ++I) {
+      SmallString<256> Buffer;
+      StringRef Text
+        = GetTypedName((CodeCompletionString *)Results[I].CompletionString,
+                       Buffer);
+      if (!Buffer.empty()) {
+        char *Copy = TextAlloc.Allocate<char>(Text.size());
+        std::copy(Text.begin(), Text.end(), Copy);
+        Text = StringRef(Copy, Text.size());
+      }
+      Typed.push_back(TypedCompletionResult(Text, Results[I]));
+    }
+
+    std::stable_sort(Typed.begin(), Typed.end(), OrderCompletionResults());
+    for (unsigned I = 0; I != NumResults; ++I)
+      Results[I] = Typed[I].second;
   }
 }
@@ -4409,6 +4409,44 @@ TEST_F(FormatTest, FormatsFunctionTypes) {
   verifyFormat("void f() { function(*some_pointer_var)[0] = 10; }");
 }
 
+TEST_F(FormatTest, BoundsSearchOnPathologicalLines) {
+  // Deeply nested calls make the line-breaking search explode. It gives up
+  // after MaxAnalyzedStates states and completes the cheapest state found so
+  // far greedily.
+  std::string Code = "int i = ";
+  for (unsigned i = 0; i != 30; ++i)
+    Code += "aaaaaaaaaa(bbbbbbbbbb, cccccccccc, ";
+  Code += "dddddddddd";
+  for (unsigned i = 0; i != 30; ++i)
+    Code += ")";
+  Code += ";";
+
+  FormatStyle Style = getLLVMStyle();
+  Style.MaxAnalyzedStates = 1000;
+  std::string Result = format(Code, Style);
+
+  // No token is lost or reordered.
+  std::string CodeTokens, ResultTokens;
+  for (unsigned i = 0, e = Code.size(); i != e; ++i)
+    if (Code[i] != ' ')
+      CodeTokens += Code[i];
+  for (unsigned i = 0, e = Result.size(); i != e; ++i)
+    if (Result[i] != ' ' && Result[i] != '\n')
+      ResultTokens += Result[i];
+  EXPECT_EQ(CodeTokens, ResultTokens);
+
+  // Lines only exceed the column limit where the indentation forces them to,
+  // i.e. where they could not have been broken any further.
+  llvm::StringRef Rest = Result;
+  while (!Rest.empty()) {
+    std::pair<llvm::StringRef, llvm::StringRef> Split = Rest.split('\n');
+    llvm::StringRef Line = Split.first;
+    if (Line.size() > Style.ColumnLimit)
+      EXPECT_EQ(llvm::StringRef::npos, Line.ltrim().find(' ')) << Line.str();
+    Rest = Split.second;
+  }
+}
+
 TEST_F(FormatTest, BreaksLongDeclarations) {
   verifyFormat("typedef LoooooooooooooooooooooooooooooooooooooooongType\n"
                "    AnotherNameForTheLongType;",
@@ -6843,6 +6881,8 @@ TEST_F(FormatTest, ParsesConfiguration) {
               ConstructorInitializerIndentWidth, 1234u);
   CHECK_PARSE("ColumnLimit: 1234", ColumnLimit, 1234u);
   CHECK_PARSE("MaxEmptyLinesToKeep: 1234", MaxEmptyLinesToKeep, 1234u);
+  CHECK_PARSE("MaxAnalyzedStates: 1234", MaxAnalyzedStates, 1234u);
+  CHECK_PARSE("MaxGreedyAttempts: 1234", MaxGreedyAttempts, 1234u);
   CHECK_PARSE("PenaltyBreakBeforeFirstCallParameter: 1234",
               PenaltyBreakBeforeFirstCallParameter, 1234u);
   CHECK_PARSE("PenaltyExcessCharacter: 1234", PenaltyExcessCharacter, 1234u);
@@ -22,6 +22,7 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 
+#include <algorithm>
 #include <sstream>
 #include <stdlib.h>
 
@@ -188,6 +189,37 @@ std::string LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
   return printDILineInfo(LineInfo);
 }
 
+namespace {
+// Orders indices into a list of module offsets by the offset they refer to.
+struct OffsetIndexComparator {
+  const std::vector<uint64_t> &Offsets;
+  OffsetIndexComparator(const std::vector<uint64_t> &Offsets)
+      : Offsets(Offsets) {}
+  bool operator()(unsigned LHS, unsigned RHS) const {
+    return Offsets[LHS] < Offsets[RHS];
+  }
+};
+}
+
+void LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
+                                   const std::vector<uint64_t> &ModuleOffsets,
+                                   std::vector<std::string> &Results) {
+  Results.clear();
+  Results.resize(ModuleOffsets.size());
+  std::vector<unsigned> Order(ModuleOffsets.size());
+  for (unsigned i = 0, e = Order.size(); i != e; ++i)
+    Order[i] = i;
+  std::stable_sort(Order.begin(), Order.end(),
+                   OffsetIndexComparator(ModuleOffsets));
+  for (unsigned i = 0, e = Order.size(); i != e; ++i) {
+    unsigned Idx = Order[i];
+    if (i != 0 && ModuleOffsets[Order[i - 1]] == ModuleOffsets[Idx])
+      Results[Idx] = Results[Order[i - 1]];
+    else
+      Results[Idx] = symbolizeCode(ModuleName, ModuleOffsets[Idx]);
+  }
+}
+
 std::string LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
                                           uint64_t ModuleOffset) {
   std::string Name = kBadString;
@@ -21,6 +21,7 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include <map>
 #include <string>
+#include <vector>
 
 namespace llvm {
 
@@ -58,6 +59,13 @@ public:
   symbolizeCode(const std::string &ModuleName, uint64_t ModuleOffset);
   std::string
   symbolizeData(const std::string &ModuleName, uint64_t ModuleOffset);
+  // Symbolizes a list of code offsets in a single module. Offsets are looked
+  // up in increasing order, so that neighbouring frames reuse the debug info
+  // parsed for the previous one, and repeated offsets are symbolized once.
+  // Results[i] is the result for ModuleOffsets[i].
+  void symbolizeCode(const std::string &ModuleName,
+                     const std::vector<uint64_t> &ModuleOffsets,
+                     std::vector<std::string> &Results);
   void flush();
   static std::string DemangleName(const std::string &Name);
 private:
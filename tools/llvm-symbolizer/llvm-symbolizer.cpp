@@ -25,7 +25,9 @@
 #include "llvm/Support/raw_ostream.h"
 #include <cstdio>
 #include <cstring>
+#include <map>
 #include <string>
+#include <vector>
 
 using namespace llvm;
 using namespace symbolize;
@@ -51,6 +53,12 @@ static cl::opt<std::string> ClDefaultArch("default-arch", cl::init(""),
                                           cl::desc("Default architecture "
                                                    "(for multi-arch objects)"));
 
+static cl::opt<bool>
+ClBatch("batch", cl::init(false),
+        cl::desc("Read all addresses before symbolizing them, look them up "
+                 "sorted by module and offset, and print the results in "
+                 "input order"));
+
 static bool parseCommand(bool &IsData, std::string &ModuleName,
                          uint64_t &ModuleOffset) {
   const char *kDataCmd = "DATA ";
@@ -112,6 +120,39 @@ int main(int argc, char **argv) {
   bool IsData = false;
   std::string ModuleName;
   uint64_t ModuleOffset;
+  if (ClBatch) {
+    // Collect all queries first. Code queries are grouped by module, so that
+    // each module's debug info is visited in address order.
+    std::vector<std::string> Results;
+    typedef std::map<std::string, std::vector<unsigned> > ModuleQueriesTy;
+    ModuleQueriesTy CodeQueries;
+    std::vector<uint64_t> Offsets;
+    while (parseCommand(IsData, ModuleName, ModuleOffset)) {
+      unsigned Idx = Results.size();
+      Results.push_back(std::string());
+      Offsets.push_back(ModuleOffset);
+      if (IsData)
+        Results[Idx] = Symbolizer.symbolizeData(ModuleName, ModuleOffset);
+      else
+        CodeQueries[ModuleName].push_back(Idx);
+    }
+    for (ModuleQueriesTy::const_iterator I = CodeQueries.begin(),
+                                         E = CodeQueries.end();
+         I != E; ++I) {
+      const std::vector<unsigned> &Indices = I->second;
+      std::vector<uint64_t> ModuleOffsets(Indices.size());
+      for (unsigned i = 0, e = Indices.size(); i != e; ++i)
+        ModuleOffsets[i] = Offsets[Indices[i]];
+      std::vector<std::string> ModuleResults;
+      Symbolizer.symbolizeCode(I->first, ModuleOffsets, ModuleResults);
+      for (unsigned i = 0, e = Indices.size(); i != e; ++i)
+        Results[Indices[i]].swap(ModuleResults[i]);
+    }
+    for (unsigned i = 0, e = Results.size(); i != e; ++i)
+      outs() << Results[i] << "\n";
+    return 0;
+  }
+
   while (parseCommand(IsData, ModuleName, ModuleOffset)) {
     std::string Result =
         IsData ? Symbolizer.symbolizeData(ModuleName, ModuleOffset)
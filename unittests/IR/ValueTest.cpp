@@ -8,7 +8,9 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Assembly/Parser.h"
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Value.h"
@@ -43,6 +45,43 @@ TEST(ValueTest, UsedInBasicBlock) {
   EXPECT_TRUE(F->arg_begin()->isUsedInBasicBlock(F->begin()));
 }
 
+TEST(ValueTest, ReplaceAllUsesWith) {
+  LLVMContext C;
+
+  const char *ModuleString = "@g = global i32 0\n"
+                             "define i32* @f(i32 %x, i32 %y) {\n"
+                             "bb0:\n"
+                             "  %x1 = add i32 %x, 1\n"
+                             "  %x2 = mul i32 %x, %x\n"
+                             "  %x3 = add i32 %x1, %x2\n"
+                             "  store i32 %x, i32* @g\n"
+                             "  store i32 %x3, i32* @g\n"
+                             "  ret i32* getelementptr (i32* @g, i32 1)\n"
+                             "}\n";
+  SMDiagnostic Err;
+  OwningPtr<Module> M(ParseAssemblyString(ModuleString, NULL, Err, C));
+
+  Function *F = M->getFunction("f");
+  Argument *X = F->arg_begin();
+  Argument *Y = ++F->arg_begin();
+  X->replaceAllUsesWith(Y);
+  EXPECT_TRUE(X->use_empty());
+  EXPECT_EQ(4u, Y->getNumUses());
+  for (Value::use_iterator UI = Y->use_begin(), E = Y->use_end(); UI != E;
+       ++UI)
+    EXPECT_EQ(Y, UI.getUse().get());
+
+  // Constant users are rebuilt rather than changed in place.
+  GlobalVariable *G = M->getGlobalVariable("g");
+  GlobalVariable *H =
+    new GlobalVariable(*M, G->getType()->getElementType(), false,
+                       GlobalValue::ExternalLinkage, 0, "h");
+  G->replaceAllUsesWith(H);
+  EXPECT_TRUE(G->use_empty());
+  EXPECT_EQ(3u, H->getNumUses());
+  EXPECT_TRUE(isa<ConstantExpr>(F->back().getTerminator()->getOperand(0)));
+}
+
 TEST(GlobalTest, CreateAddressSpace) {
   LLVMContext &Ctx = getGlobalContext();
   OwningPtr<Module> M(new Module("TestModule", Ctx));